@@ -0,0 +1,58 @@
+/*
+
+  ArrayMathBench.java
+
+  Runs the native nanovm.util.ArrayMath kernels over sample arrays.
+  ArrayMathLoops does the same work in plain java loops and prints
+  the same results. Compare the run times of both, e.g.
+
+    time ./NanoVM ArrayMathBench.nvm
+    time ./NanoVM ArrayMathLoops.nvm
+
+ */
+
+import nanovm.util.ArrayMath;
+
+class ArrayMathBench {
+  static final int SAMPLES = 32;
+  static final int WINDOW = 8;
+  static final int ROUNDS = 200;
+
+  public static void main(String[] args) {
+    int[] a = new int[SAMPLES];
+    int[] avg = new int[SAMPLES];
+    float[] f = new float[SAMPLES];
+    float[] favg = new float[SAMPLES];
+
+    for(int i = 0; i < SAMPLES; i++) {
+      a[i] = (i * 37) % 101 - 50;
+      f[i] = a[i] / 4.0f;
+    }
+
+    int isum = 0, idot = 0, imin = 0, imax = 0, iavg = 0;
+    float fsum = 0, fdot = 0, fmin = 0, fmax = 0, favgsum = 0;
+
+    for(int r = 0; r < ROUNDS; r++) {
+      isum += ArrayMath.sum(a);
+      idot += ArrayMath.dot(a, a);
+      imin += ArrayMath.min(a);
+      imax += ArrayMath.max(a);
+      ArrayMath.movingAverage(a, avg, WINDOW);
+      ArrayMath.scale(avg, 3, 4);
+      iavg += ArrayMath.sum(avg);
+
+      fsum += ArrayMath.sum(f);
+      fdot += ArrayMath.dot(f, f);
+      fmin += ArrayMath.min(f);
+      fmax += ArrayMath.max(f);
+      ArrayMath.movingAverage(f, favg, WINDOW);
+      ArrayMath.scale(favg, 0.5f);
+      favgsum += ArrayMath.sum(favg);
+    }
+
+    System.out.println("int:   sum=" + isum + " dot=" + idot + " min=" + imin +
+		       " max=" + imax + " avg=" + iavg);
+    System.out.println("float: sum=" + fsum + " dot=" + fdot + " min=" + fmin +
+		       " max=" + fmax + " avg=" + favgsum);
+  }
+}
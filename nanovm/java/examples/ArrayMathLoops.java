@@ -0,0 +1,125 @@
+/*
+
+  ArrayMathLoops.java
+
+  The java loop equivalent of ArrayMathBench, see there.
+
+ */
+
+class ArrayMathLoops {
+  static final int SAMPLES = 32;
+  static final int WINDOW = 8;
+  static final int ROUNDS = 200;
+
+  static int sum(int[] a) {
+    int s = 0;
+    for(int i = 0; i < a.length; i++) s += a[i];
+    return s;
+  }
+
+  static int dot(int[] a, int[] b) {
+    int s = 0;
+    for(int i = 0; i < a.length; i++) s += a[i] * b[i];
+    return s;
+  }
+
+  static int min(int[] a) {
+    int v = a[0];
+    for(int i = 1; i < a.length; i++) if(a[i] < v) v = a[i];
+    return v;
+  }
+
+  static int max(int[] a) {
+    int v = a[0];
+    for(int i = 1; i < a.length; i++) if(a[i] > v) v = a[i];
+    return v;
+  }
+
+  static void movingAverage(int[] src, int[] dst, int window) {
+    int s = 0;
+    for(int i = 0; i < src.length; i++) {
+      s += src[i];
+      if(i >= window) s -= src[i - window];
+      dst[i] = s / ((i < window)?(i + 1):window);
+    }
+  }
+
+  static void scale(int[] a, int mul, int div) {
+    for(int i = 0; i < a.length; i++) a[i] = a[i] * mul / div;
+  }
+
+  static float sum(float[] a) {
+    float s = 0;
+    for(int i = 0; i < a.length; i++) s += a[i];
+    return s;
+  }
+
+  static float dot(float[] a, float[] b) {
+    float s = 0;
+    for(int i = 0; i < a.length; i++) s += a[i] * b[i];
+    return s;
+  }
+
+  static float min(float[] a) {
+    float v = a[0];
+    for(int i = 1; i < a.length; i++) if(a[i] < v) v = a[i];
+    return v;
+  }
+
+  static float max(float[] a) {
+    float v = a[0];
+    for(int i = 1; i < a.length; i++) if(a[i] > v) v = a[i];
+    return v;
+  }
+
+  static void movingAverage(float[] src, float[] dst, int window) {
+    float s = 0;
+    for(int i = 0; i < src.length; i++) {
+      s += src[i];
+      if(i >= window) s -= src[i - window];
+      dst[i] = s / ((i < window)?(i + 1):window);
+    }
+  }
+
+  static void scale(float[] a, float mul) {
+    for(int i = 0; i < a.length; i++) a[i] = a[i] * mul;
+  }
+
+  public static void main(String[] args) {
+    int[] a = new int[SAMPLES];
+    int[] avg = new int[SAMPLES];
+    float[] f = new float[SAMPLES];
+    float[] favg = new float[SAMPLES];
+
+    for(int i = 0; i < SAMPLES; i++) {
+      a[i] = (i * 37) % 101 - 50;
+      f[i] = a[i] / 4.0f;
+    }
+
+    int isum = 0, idot = 0, imin = 0, imax = 0, iavg = 0;
+    float fsum = 0, fdot = 0, fmin = 0, fmax = 0, favgsum = 0;
+
+    for(int r = 0; r < ROUNDS; r++) {
+      isum += sum(a);
+      idot += dot(a, a);
+      imin += min(a);
+      imax += max(a);
+      movingAverage(a, avg, WINDOW);
+      scale(avg, 3, 4);
+      iavg += sum(avg);
+
+      fsum += sum(f);
+      fdot += dot(f, f);
+      fmin += min(f);
+      fmax += max(f);
+      movingAverage(f, favg, WINDOW);
+      scale(favg, 0.5f);
+      favgsum += sum(favg);
+    }
+
+    System.out.println("int:   sum=" + isum + " dot=" + idot + " min=" + imin +
+		       " max=" + imax + " avg=" + iavg);
+    System.out.println("float: sum=" + fsum + " dot=" + fdot + " min=" + fmin +
+		       " max=" + fmax + " avg=" + favgsum);
+  }
+}
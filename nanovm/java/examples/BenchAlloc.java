@@ -0,0 +1,43 @@
+/*
+
+  BenchAlloc.java
+
+  Allocation heavy workload for "make bench": short lived arrays,
+  objects and strings keep the garbage collector busy.
+  Expected output:
+
+  BenchAlloc 131250 x499
+
+ */
+
+class BenchAlloc {
+  int value;
+  BenchAlloc next;
+
+  BenchAlloc(int value, BenchAlloc next) {
+    this.value = value;
+    this.next = next;
+  }
+
+  public static void main(String[] args) {
+    String last = "";
+    int sum = 0;
+
+    for(int i=0;i<500;i++) {
+      int[] tmp = new int[8];
+      tmp[i & 7] = i;
+      sum += tmp[i & 7] + tmp.length;
+
+      // a short list, garbage again in the next round
+      BenchAlloc list = null;
+      for(int j=0;j<4;j++)
+	list = new BenchAlloc(j, list);
+      sum += list.value + list.next.value;
+
+      if((i % 50) == 49)
+	last = "x" + i;
+    }
+
+    System.out.println("BenchAlloc " + sum + " " + last);
+  }
+}
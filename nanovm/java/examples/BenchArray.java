@@ -0,0 +1,51 @@
+/*
+
+  BenchArray.java
+
+  Array heavy workload for "make bench": fills and bubble sorts
+  a small int array and sieves primes in a byte array.
+  Expected output:
+
+  BenchArray 591 25
+
+ */
+
+class BenchArray {
+  static final int SIZE = 32;
+
+  public static void main(String[] args) {
+    int[] a = new int[SIZE];
+    byte[] sieve = new byte[100];
+    int sum = 0, primes = 0;
+
+    for(int r=0;r<20;r++) {
+      for(int i=0;i<SIZE;i++)
+	a[i] = (i*37 + r) % 101;
+
+      for(int i=0;i<SIZE-1;i++)
+	for(int j=0;j<SIZE-1-i;j++)
+	  if(a[j] > a[j+1]) {
+	    int t = a[j];
+	    a[j] = a[j+1];
+	    a[j+1] = t;
+	  }
+
+      sum += a[r % SIZE];
+    }
+
+    for(int r=0;r<10;r++) {
+      for(int i=0;i<sieve.length;i++)
+	sieve[i] = 1;
+
+      primes = 0;
+      for(int i=2;i<sieve.length;i++)
+	if(sieve[i] != 0) {
+	  primes++;
+	  for(int j=i+i;j<sieve.length;j+=i)
+	    sieve[j] = 0;
+	}
+    }
+
+    System.out.println("BenchArray " + sum + " " + primes);
+  }
+}
@@ -0,0 +1,47 @@
+/*
+
+  BenchCall.java
+
+  Call heavy workload for "make bench": recursive static calls,
+  plain static calls and virtual calls on an object.
+  Expected output:
+
+  BenchCall 12100
+
+ */
+
+class BenchCall {
+  int value;
+
+  BenchCall(int value) {
+    this.value = value;
+  }
+
+  int get() {
+    return value;
+  }
+
+  static int fib(int n) {
+    if(n < 2)
+      return 1;
+    return fib(n-2) + fib(n-1);
+  }
+
+  static int add(int a, int b) {
+    return a + b;
+  }
+
+  public static void main(String[] args) {
+    BenchCall obj = new BenchCall(3);
+    int sum = 0;
+
+    // keep the recursion shallow, the stack lives in the heap
+    for(int r=0;r<10;r++)
+      sum = add(sum, fib(14));
+
+    for(int i=0;i<2000;i++)
+      sum = add(sum, obj.get()) & 0xffff;
+
+    System.out.println("BenchCall " + sum);
+  }
+}
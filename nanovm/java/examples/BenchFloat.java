@@ -0,0 +1,31 @@
+/*
+
+  BenchFloat.java
+
+  Float workload for "make bench": a first order low pass filter
+  and newton iterations for square roots.
+  Expected output:
+
+  BenchFloat 99 671
+
+ */
+
+class BenchFloat {
+  public static void main(String[] args) {
+    float y = 0;
+    float roots = 0;
+
+    for(int i=0;i<2000;i++)
+      y = y * 0.99f + 1.0f;
+
+    for(int i=1;i<=100;i++) {
+      float x = i;
+      float r = x;
+      for(int n=0;n<8;n++)
+	r = 0.5f * (r + x / r);
+      roots += r;
+    }
+
+    System.out.println("BenchFloat " + (int)y + " " + (int)roots);
+  }
+}
@@ -0,0 +1,35 @@
+/*
+
+  BenchNative.java
+
+  Native call heavy workload for "make bench": many calls to
+  cheap native math and array methods.
+  Expected output:
+
+  BenchNative 2500 9300 99
+
+ */
+
+import nanovm.lang.Math;
+import nanovm.util.ArrayMath;
+
+class BenchNative {
+  public static void main(String[] args) {
+    int[] a = new int[16];
+    int abs = 0, sum = 0, max = 0;
+
+    for(int i=0;i<16;i++)
+      a[i] = i - 8;
+
+    for(int i=0;i<100;i++) {
+      for(int j=0;j<10;j++) {
+	abs += Math.abs(j - 5) + Math.abs(i - 50) - Math.abs(i - 50);
+	max = Math.max(max, Math.min(i, 99));
+      }
+      a[i & 15] += 2;
+      sum += ArrayMath.sum(a);
+    }
+
+    System.out.println("BenchNative " + abs + " " + sum + " " + max);
+  }
+}
@@ -0,0 +1,39 @@
+/*
+
+  BenchSwitch.java
+
+  Switch workload for "make bench": a state machine using a
+  tableswitch and sparse keys using a lookupswitch.
+  Expected output:
+
+  BenchSwitch 7999 1000000
+
+ */
+
+class BenchSwitch {
+  public static void main(String[] args) {
+    int state = 0, table = 0, lookup = 0;
+
+    for(int i=0;i<4000;i++) {
+      switch(state) {
+	case 0:  state = 3; table += 1; break;
+	case 1:  state = 5; table += 2; break;
+	case 2:  state = 0; table += 3; break;
+	case 3:  state = 1; table += 1; break;
+	case 4:  state = 2; table += 2; break;
+	case 5:  state = 4; table += 3; break;
+	default: state = 0; break;
+      }
+
+      switch((i & 3) * 100) {
+	case 0:     lookup += 1000; break;
+	case 100:   lookup -= 1; break;
+	case 10000: lookup -= 7; break;
+	case 200:   lookup += 1; break;
+	default:    break;
+      }
+    }
+
+    System.out.println("BenchSwitch " + table + " " + lookup);
+  }
+}
@@ -0,0 +1,53 @@
+/*
+
+  FloatConvTest.java
+
+  Prints floats through the Formatter and StringBuffer.append(float).
+  The NanoVM converts them with integer arithmetic only, the output
+  has to match the C library, i.e. printf() with the same format
+  (append uses %g with the fewest digits that read back as the
+  same float, see vm/src/unix/floatcheck.c). Expected output:
+
+  0.125000 0.12 0 1.250000e-01 1.250e-01 0.125 0.125 0.125000 0x1p-3
+  2.500000 2.50 2 2.500000e+00 2.500e+00 2.5 2.5 2.50000 0x1.4p+1
+  0.050000 0.05 0 5.000000e-02 5.000e-02 0.05 0.05 0.0500000 0x1.99999ap-5
+  9.999999 10.00 10 9.999999e+00 1.000e+01 10 10 10.0000 0x1.3ffffep+3
+  10000000000.000000 10000000000.00 10000000000 1.000000e+10 1.000e+10 1e+10 1e+10 1.00000e+10 0x1.2a05f2p+33
+  0.000000 0.00 0 9.999946e-41 1.000e-40 9.99995e-41 1e-40 9.99995e-41 0x1.16c2p-133
+  -0.000000 -0.00 -0 -0.000000e+00 -0.000e+00 -0 -0 -0.00000 -0x0p+0
+  3.141593 3.14 3 3.141593e+00 3.142e+00 3.14159 3.14 3.14159 0x1.921fb6p+1
+  0.125 2.5 0.05 9.999999 1e+10 1e-40 -0 3.1415927
+
+ */
+
+import nanovm.util.Formatter;
+
+class FloatConvTest {
+
+  static void printFormats(float val) {
+    StringBuffer line = new StringBuffer();
+    Formatter.append(line, val, "%f");
+    Formatter.append(line, val, " %.2f");
+    Formatter.append(line, val, " %.0f");
+    Formatter.append(line, val, " %e");
+    Formatter.append(line, val, " %.3e");
+    Formatter.append(line, val, " %g");
+    Formatter.append(line, val, " %.3g");
+    Formatter.append(line, val, " %#g");
+    Formatter.append(line, val, " %a");
+    System.out.println(line.toString());
+  }
+
+  public static void main(String[] args) {
+    float[] vals = { 0.125f, 2.5f, 0.05f, 9.9999995f,
+                     1e10f, 1e-40f, -0.0f, 3.14159265f };
+
+    for(int i=0;i<vals.length;i++)
+      printFormats(vals[i]);
+
+    String all = "";
+    for(int i=0;i<vals.length;i++)
+      all = all + vals[i] + " ";
+    System.out.println(all);
+  }
+}
@@ -42,6 +42,13 @@ class FormatterTest {
     TestFloatFormatted("+7.3f");
     System.out.println("Floats");
     TestFloatFormatted("+4.0f");
+
+    System.out.println("Append");
+    StringBuffer line = new StringBuffer();
+    Formatter.append(line, 42, "x=%4d");
+    Formatter.append(line, Math.PI, " y=%.3f");
+    Formatter.append(line, false, " z=%b");
+    System.out.println(line.toString());
   }
 }
 
@@ -0,0 +1,16 @@
+//
+// nanovm/io/Console.java
+//
+// When converting NanoVM code using the Convert tool, this
+// code will magically be replaced by native methods. This
+// code will never be called.
+//
+
+package nanovm.io;
+
+public class Console {
+  // Wait up to ms milliseconds for input on System.in instead of
+  // spinning on System.in.available(). Returns the number of bytes
+  // that can be read without blocking, 0 on timeout.
+  public static native int waitAvailable(int ms);
+}
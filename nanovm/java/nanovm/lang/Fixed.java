@@ -0,0 +1,33 @@
+//
+// nanovm/lang/Fixed.java
+//
+// When converting NanoVM code using the Convert tool, this
+// code will magically be replaced by native methods. This
+// code will never be called.
+//
+
+package nanovm.lang;
+
+// Q16.16 fixed point arithmetic on plain ints, for targets without
+// a fast float. Addition, subtraction and comparison are the usual
+// int operations. Since the NanoVM uses 31 bit ints, values range
+// from -16384 to 16384 with a resolution of 1/65536.
+public class Fixed
+{
+  public static final int ONE = 0x10000;
+  public static final int HALF = 0x8000;
+  public static final int PI = 205887;
+  public static final int E = 178145;
+
+  public native static int mul(int a, int b);
+  public native static int div(int a, int b);
+  public native static int sqrt(int a);
+  // angles in radians
+  public native static int sin(int a);
+  public native static int cos(int a);
+
+  public native static int fromInt(int a);
+  public native static int toInt(int a);
+  public native static int fromFloat(float a);
+  public native static float toFloat(int a);
+}
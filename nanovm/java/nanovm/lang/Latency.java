@@ -0,0 +1,34 @@
+//
+// nanovm/lang/Latency.java
+//
+// When converting NanoVM code using the Convert tool, this
+// code will magically be replaced by native methods. This
+// code will never be called.
+//
+
+package nanovm.lang;
+
+// Histograms of the time taken by garbage collector runs, native
+// calls and selected methods. Bucket b counts the times from 2^(b-1)
+// to 2^b-1 timer units (microseconds on unix and stm32, timer 1
+// counts on avr), bucket 0 those too short to measure and the last
+// one everything longer.
+public class Latency
+{
+  // histograms
+  public static final int GC = 0;
+  public static final int NATIVE = 1;
+  public static final int METHOD = 2;   // METHOD+slot for select(slot, ...)
+
+  public static final int BUCKETS = 16;
+  public static final int METHODS = 4;
+
+  // time method (index as in the .map file) in histogram METHOD+slot,
+  // -1 stops it
+  public native static void select(int slot, int method);
+  public native static int count(int hist, int bucket);
+  public native static int max(int hist);
+  // clears all histograms, the garbage collector and native calls
+  // are only timed after the first reset() (or with "NanoVM -L")
+  public native static void reset();
+}
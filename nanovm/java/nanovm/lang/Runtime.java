@@ -0,0 +1,33 @@
+//
+// nanovm/lang/Runtime.java
+//
+// When converting NanoVM code using the Convert tool, this
+// code will magically be replaced by native methods. This
+// code will never be called.
+//
+
+package nanovm.lang;
+
+// Heap usage and garbage collector counters. Counters that don't
+// fit into an int stop at the largest int.
+public class Runtime
+{
+  // ids for stat()
+  public static final int SIZE = 0;         // total heap size
+  public static final int FREE = 1;         // free bytes, one single block
+  public static final int ALLOCS = 2;       // objects allocated
+  public static final int ALLOC_BYTES = 3;  // bytes allocated for them
+  public static final int GC_RUNS = 4;      // garbage collections
+  public static final int RECLAIMED = 5;    // objects removed by the gc
+  public static final int MOVED = 6;        // bytes moved while compacting
+  public static final int GC_CHECKS = 7;    // liveness checks of all gc runs
+  public static final int GC_MAX = 8;       // checks of the longest gc run
+  public static final int STACK_PEAK = 9;   // most bytes used by the stack
+  public static final int USED_PEAK = 10;   // most bytes used by stack and objects
+
+  public native static int freeMemory();
+  public native static int totalMemory();
+  public native static int gcCount();
+  public native static void gc();
+  public native static int stat(int id);
+}
@@ -0,0 +1,30 @@
+//
+// nanovm/lang/Thread.java
+//
+// When converting NanoVM code using the Convert tool, this
+// code will magically be replaced by native methods. This
+// code will never be called.
+//
+
+package nanovm.lang;
+
+// Green threads of the vm. They take turns every few hundred
+// bytecodes and whenever one sleeps, yields or joins. Either pass
+// a Runnable or extend the class and override run(), a subclass
+// ignores the Runnable. main() returns once all threads have ended.
+public class Thread implements Runnable
+{
+  public Thread() { }
+  public Thread(Runnable target) { }
+
+  public void run() { }
+
+  public native void start();
+  public native void join();
+  public native boolean isAlive();
+
+  // milliseconds on unix, timer ticks (see nanovm.avr.Timer) on
+  // the avr and the stm32
+  public native static void sleep(int time);
+  public native static void yield();
+}
@@ -0,0 +1,34 @@
+//
+// nanovm/util/ArrayMath.java
+//
+// When converting NanoVM code using the Convert tool, this
+// code will magically be replaced by native methods. This
+// code will never be called.
+//
+
+package nanovm.util;
+
+public class ArrayMath {
+  public static native int sum(int[] a);
+  public static native float sum(float[] a);
+
+  // both arrays must have the same length
+  public static native int dot(int[] a, int[] b);
+  public static native float dot(float[] a, float[] b);
+
+  // a[i] = a[i] * mul / div, resp. a[i] = a[i] * mul
+  public static native void scale(int[] a, int mul, int div);
+  public static native void scale(float[] a, float mul);
+
+  // the array must not be empty
+  public static native int min(int[] a);
+  public static native float min(float[] a);
+  public static native int max(int[] a);
+  public static native float max(float[] a);
+
+  // dst[i] is the mean of src[i-window+1] to src[i] (of the samples
+  // available at the start). dst must be a different array of the
+  // same length as src.
+  public static native void movingAverage(int[] src, int[] dst, int window);
+  public static native void movingAverage(float[] src, float[] dst, int window);
+}
@@ -0,0 +1,24 @@
+//
+// nanovm/util/Arrays.java
+//
+// When converting NanoVM code using the Convert tool, this
+// code will magically be replaced by native methods. This
+// code will never be called.
+//
+
+package nanovm.util;
+
+public class Arrays {
+  // Bulk operations on whole arrays, done natively instead of
+  // element by element. Use System.arraycopy() to move ranges.
+  // Object arrays are int arrays inside the vm, arraycopy() doesn't
+  // notice a copy between an int[] and an Object[], don't do that.
+  public static native void fill(byte[] a, byte val);
+  public static native void fill(int[] a, int val);
+  public static native void fill(Object[] a, Object val);
+  public static native boolean equals(byte[] a, byte[] b);
+  public static native boolean equals(int[] a, int[] b);
+  public static native byte[] copyOf(byte[] a, int length);
+  public static native int[] copyOf(int[] a, int length);
+  public static native Object[] copyOf(Object[] a, int length);
+}
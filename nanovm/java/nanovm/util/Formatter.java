@@ -16,4 +16,15 @@ public class Formatter {
   public static native String format(int val, String format);
   public static native String format(boolean val, String format);
   public static native String format(float val, String format);
+
+  // val is a Q16.16 fixed point value, see nanovm.lang.Fixed. The
+  // precision defaults to four digits
+  public static native String formatFixed(int val, String format);
+
+  // format directly into buf instead of creating a temporary string,
+  // buf is returned to allow chaining
+  public static native StringBuffer append(StringBuffer buf, int val, String format);
+  public static native StringBuffer append(StringBuffer buf, boolean val, String format);
+  public static native StringBuffer append(StringBuffer buf, float val, String format);
+  public static native StringBuffer appendFixed(StringBuffer buf, int val, String format);
 }
@@ -243,7 +243,7 @@ public class ClassInfo extends CommonInfo {
 
     // add fields of super classes (only for non-native classes)
     if(getSuperClassIndex() < NativeMapper.lowestNativeId) 
-      sum += ClassLoader.getClassInfo(getSuperClassIndex()).nonStaticFields();
+      sum += ClassLoader.getClassInfo(getSuperClassName()).nonStaticFields();
 
     return sum;
   }
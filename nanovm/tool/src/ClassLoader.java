@@ -25,9 +25,24 @@ import java.util.Vector;
 import java.util.StringTokenizer;
 
 public class ClassLoader {
+  // resident library classes and methods are numbered behind the
+  // ones of the application image
+  static final int LIBRARY_CLASS_BASE  = 8;
+  static final int LIBRARY_METHOD_BASE = 0x800;
+
   static private Vector classes = new Vector();
   static private String classPath = null;
 
+  // when building a library image, all classes belong to the library.
+  // when linking against a library, the first libraryClasses classes
+  // are the resident ones and are not written to the image
+  static private boolean buildLibrary = false;
+  static private int libraryClasses = 0;
+
+  // library methods referenced by the application (global method
+  // indices), these become the import table of the image
+  static private Vector imports = new Vector();
+
   static public void setClassPath(String path) {
     classPath = path;
   }
@@ -58,16 +73,24 @@ public class ClassLoader {
     return getClassInfo(classIndex);
   }
 
-  // get index of class named className
+  // get id of class named className as used inside the image
   public static int getClassIndex(String className) {
     // search through all classes
     for(int i=0;i<classes.size();i++) {
       if(getClassInfo(i).getName().equals(className))
-	return i;
+	return getClassId(i);
     }
     return -1;
   }
 
+  // map position in the list of loaded classes to the class id
+  static int getClassId(int index) {
+    if(buildLibrary || (index < libraryClasses))
+      return LIBRARY_CLASS_BASE + index;
+
+    return index - libraryClasses;
+  }
+
   public static boolean methodExists(String className, 
 				     String name, String type) {
     // search through all classes
@@ -82,8 +105,8 @@ public class ClassLoader {
     return false;
   }
 
-  // search through all classes and return index of matching method
-  public static int getMethodIndex(String className, String name, String type) {
+  // search through all classes and return global index of matching method
+  static int getGlobalMethodIndex(String className, String name, String type) {
     for(int i=0, index=0;i<classes.size();i++) {
       if(getClassInfo(i).getName().equals(className)) {
 	index += getClassInfo(i).getMethodIndex(name, type);
@@ -94,6 +117,25 @@ public class ClassLoader {
     return -1;
   }
 
+  // search through all classes and return the index of the matching
+  // method as used by the invoke instructions of the image
+  public static int getMethodIndex(String className, String name, String type) {
+    int index = getGlobalMethodIndex(className, name, type);
+
+    if(index < 0)
+      return -1;
+
+    if(buildLibrary)
+      return LIBRARY_METHOD_BASE + index;
+
+    // calls into the resident library go through the import table
+    // that follows the methods of the application
+    if(index < firstImageMethod())
+      return imageMethods() + imports.indexOf(new Integer(index));
+
+    return index - firstImageMethod();
+  }
+
   public static boolean fieldExistsExact(String className, 
 				    String name, String type) {
     // search through all classes
@@ -183,14 +225,14 @@ public class ClassLoader {
   public static int totalConstantEntries() {
     int sum = 0;
 
-    for(int i=0;i<classes.size();i++) 
+    for(int i=libraryClasses;i<classes.size();i++) 
       sum += getClassInfo(i).getConstPool().totalConstantEntries();
 
     return sum;
   }
 
   public static int getConstantEntry(int index) {
-    int i=0;
+    int i=libraryClasses;
     
     // search through all classes
     while(index >= getClassInfo(i).getConstPool().totalConstantEntries()) 
@@ -204,7 +246,7 @@ public class ClassLoader {
   public static int totalStringSize() {
     int sum = 0;
 
-    for(int i=0;i<classes.size();i++) 
+    for(int i=libraryClasses;i<classes.size();i++) 
       sum += getClassInfo(i).getConstPool().totalStringSize();
 
     return sum;
@@ -214,14 +256,14 @@ public class ClassLoader {
   public static int totalStrings() {
     int sum = 0;
 
-    for(int i=0;i<classes.size();i++) 
+    for(int i=libraryClasses;i<classes.size();i++) 
       sum += getClassInfo(i).getConstPool().totalStrings();
 
     return sum;
   }
 
   public static String getString(int index) {
-    int i=0;
+    int i=libraryClasses;
     
     // search through all classes
     while(index >= getClassInfo(i).getConstPool().totalStrings()) 
@@ -241,10 +283,10 @@ public class ClassLoader {
     return sum;
   }
 
-  // return index of main method (must be in class 0, since
-  // it is the one the user gave as an argument)
+  // return index of main method (must be in the first class of the
+  // image, since it is the one the user gave as an argument)
   public static int getMainIndex() {
-    return getClassInfo(0).getMethodIndex("main", "([Ljava/lang/String;)V");
+    return getClassInfo(libraryClasses).getMethodIndex("main", "([Ljava/lang/String;)V");
   }
   
   public static MethodInfo getMethod(int index) {
@@ -272,6 +314,141 @@ public class ClassLoader {
     return i;
   }
 
+  // number of classes written to the image
+  public static int imageClasses() {
+    return classes.size() - libraryClasses;
+  }
+
+  public static ClassInfo getImageClassInfo(int index) {
+    return getClassInfo(libraryClasses + index);
+  }
+
+  // global index of the first method written to the image
+  static int firstImageMethod() {
+    int num = 0;
+
+    for(int i=0;i<libraryClasses;i++) 
+      num += getClassInfo(i).methods();
+
+    return num;
+  }
+
+  // number of methods written to the image (without imports)
+  public static int imageMethods() {
+    return totalMethods() - firstImageMethod();
+  }
+
+  public static MethodInfo getImageMethod(int index) {
+    return getMethod(firstImageMethod() + index);
+  }
+
+  public static ClassInfo getImageClassInfoFromMethodIndex(int index) {
+    return getClassInfoFromMethodIndex(firstImageMethod() + index);
+  }
+
+  // class id of the image method with index
+  public static int getImageClassIndex(int index) {
+    return getClassId(getClassIndex(firstImageMethod() + index));
+  }
+
+  // method id of the image method with index
+  public static int getImageMethodId(int index) {
+    return MethodIdTable.getEntry(firstImageMethod() + index);
+  }
+
+  public static void setBuildLibrary() {
+    buildLibrary = true;
+  }
+
+  public static boolean isBuildLibrary() {
+    return buildLibrary;
+  }
+
+  // load the classes of the resident library, comma separated
+  public static void loadLibrary(String names) {
+    StringTokenizer st = new StringTokenizer(names, ",");
+
+    while(st.hasMoreTokens()) {
+      String name = st.nextToken();
+
+      if(getClassInfo(name) == null)
+	load(name);
+    }
+
+    if(!buildLibrary)
+      libraryClasses = classes.size();
+
+    if(classes.size() > LIBRARY_CLASS_BASE) {
+      System.out.println("ERROR: library exceeds " + 
+			 LIBRARY_CLASS_BASE + " classes");
+      System.exit(-1);
+    }
+  }
+
+  // the application classes get the ids below the library ones
+  public static void checkImageClasses() {
+    if((libraryClasses > 0) && (imageClasses() > LIBRARY_CLASS_BASE)) {
+      System.out.println("ERROR: application exceeds " +
+			 LIBRARY_CLASS_BASE + " classes");
+      System.exit(-1);
+    }
+  }
+
+  public static boolean usesLibrary() {
+    return buildLibrary || (libraryClasses > 0);
+  }
+
+  // identification of the library interface (classes, fields and
+  // methods in order). An application image only links against a
+  // library with matching id
+  public static int getLibraryId() {
+    int count = buildLibrary?classes.size():libraryClasses;
+    int hash = 0;
+
+    for(int i=0;i<count;i++) {
+      ClassInfo classInfo = getClassInfo(i);
+
+      hash = 31*hash + classInfo.getName().hashCode();
+      hash = 31*hash + classInfo.staticFields();
+      hash = 31*hash + classInfo.nonStaticFields();
+
+      for(int j=0;j<classInfo.methods();j++) {
+	MethodInfo methodInfo = classInfo.getMethod(j);
+	hash = 31*hash + methodInfo.getName().hashCode();
+	hash = 31*hash + methodInfo.getSignature().hashCode();
+      }
+    }
+
+    return (hash ^ (hash >>> 16)) & 0xffff;
+  }
+
+  // collect all library methods called from the application classes
+  public static void collectImports() {
+    for(int i=libraryClasses;i<classes.size();i++)
+      getClassInfo(i).getConstPool().collectImports(imports);
+
+    System.out.println(imports.size() + " library methods imported");
+  }
+
+  public static int totalImports() {
+    return imports.size();
+  }
+
+  // global method index of import table entry
+  public static int getImport(int index) {
+    return ((Integer)imports.elementAt(index)).intValue();
+  }
+
+  // class id of the class the import table entry belongs to
+  public static int getImportClassIndex(int index) {
+    return getClassId(getClassIndex(getImport(index)));
+  }
+
+  // tell whether the global method index belongs to the library
+  public static boolean isLibraryMethod(int index) {
+    return index < firstImageMethod();
+  }
+
   public static void constantRelocate(int i) {
     System.out.println("request to relocate " + i);
   }
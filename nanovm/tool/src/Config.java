@@ -41,6 +41,7 @@ public class Config {
   static int target = TARGET_NONE;
   static String targetFile = null;
   static int targetSpeed = -1;
+  static boolean rawFloat = false;
 
   static public int getTarget() {
     return target;
@@ -58,6 +59,10 @@ public class Config {
     return targetSpeed;
   }
 
+  static public boolean useRawFloat() {
+    return rawFloat;
+  }
+
   static public int getMaxSize() {
     return maxSize;   // asuro
   }
@@ -133,6 +138,8 @@ public class Config {
 	    targetFile = value;
 	  } else if(name.equalsIgnoreCase("speed") && (value != null)) {
 	    targetSpeed = Integer.parseInt(value);
+	  } else if(name.equalsIgnoreCase("rawfloat")) {
+	    rawFloat = true;
 	  } else {
 	    System.out.println("ERROR: Unknown config entry \"" + name + "\"");
 	    System.exit(-1);
@@ -292,6 +292,13 @@ public class ConstPool {
 
   static int encodeFloat(float val) {
     int ival = Float.floatToRawIntBits(val);
+
+    // vm keeps floats unchanged on its stack
+    if(Config.useRawFloat()) {
+      UsedFeatures.add(UsedFeatures.RAWFLOAT);
+      return ival;
+    }
+
     boolean sign = ival<0;
     int exponent = ((ival>>23)&0xff);
     ival &= 0x007fffff;
@@ -424,8 +431,7 @@ public class ConstPool {
 
       // didn't work? try native methods
       if(index == -1) {
-	id = NativeMapper.getMethodId(
-	  getClassName(entry), getMethodName(entry), getMethodType(entry));
+	id = getNativeMethodId(entry);
 
 	if(id == -1) {
 	  System.out.println("Unable to map method reference");
@@ -484,6 +490,43 @@ public class ConstPool {
     return id;
   }
     
+  // id of a native method, also of one inherited from a native
+  // class (e.g. start() of a subclass of nanovm.lang.Thread)
+  private int getNativeMethodId(ConstPoolEntry entry) {
+    String className = getClassName(entry);
+    int id = -1;
+
+    while((id == -1) && (className != null)) {
+      id = NativeMapper.getMethodId(
+	className, getMethodName(entry), getMethodType(entry));
+      className = ClassLoader.getSuperClassName(className);
+    }
+
+    return id;
+  }
+
+  // add all library methods referenced by this class to the import list
+  public void collectImports(Vector imports) {
+    for(int i=0;i<size();i++) {
+      ConstPoolEntry entry = getEntryAtIndex(i);
+
+      if(entry.typecode() == ConstPoolEntry.METHODREF) {
+	int index = ClassLoader.getGlobalMethodIndex(
+	  getClassName(entry), getMethodName(entry), getMethodType(entry));
+
+	if((index >= 0) && ClassLoader.isLibraryMethod(index)) {
+	  Integer ref = new Integer(index);
+
+	  if(!imports.contains(ref)) {
+	    System.out.println("Import " + getClassName(entry) +"."+ 
+			       getMethodName(entry) +":"+ getMethodType(entry));
+	    imports.addElement(ref);
+	  }
+	}
+      }
+    }
+  }
+
   public void resolveMethodRefs() {
     System.out.println("Resolving method references ...");
 
@@ -496,8 +539,7 @@ public class ConstPool {
 	System.out.print("Method " + getClassName(entry) +"."+ 
 			 getMethodName(entry) +":"+ getMethodType(entry));
 
-	if(!NativeMapper.methodIsNative(getClassName(entry), 
-				getMethodName(entry), getMethodType(entry))) {
+	if(getNativeMethodId(entry) == -1) {
 
 	  // check if we already know a method like this
 	  if(!ClassLoader.methodExists(getClassName(entry), 
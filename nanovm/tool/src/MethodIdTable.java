@@ -25,8 +25,17 @@
 //
 
 public class MethodIdTable {
+  // run()V has this id in every class, the vm looks it up by
+  // the class of an object to start a thread with it
+  public static final int RUN_ID = 0;
+
   private static int[] mindex;
 
+  private static boolean isRun(int i) {
+    return ClassLoader.getMethod(i).getName().equals("run") &&
+      ClassLoader.getMethod(i).getSignature().equals("()V");
+  }
+
   // build the complete method id table
   public static void build() {
     mindex = new int[ClassLoader.totalMethods()];
@@ -34,8 +43,12 @@ public class MethodIdTable {
     // clear index table
     for(int i=0;i<ClassLoader.totalMethods();i++) mindex[i] = -1;
 
+    // run()V first, its id is reserved even if there is none
+    for(int i=0;i<ClassLoader.totalMethods();i++)
+      if(isRun(i)) mindex[i] = RUN_ID;
+
     // generate table
-    for(int i=0,id = 0;i<ClassLoader.totalMethods();i++) {
+    for(int i=0,id = RUN_ID+1;i<ClassLoader.totalMethods();i++) {
       // entry has not been set yet
       if(mindex[i] == -1) {
 	// use same id on all methods mit same name and signature
@@ -36,16 +36,24 @@ class NVMComm2 {
 
 	protected static final int MAX_DATA_LEN = 16;      // Maximum data length to use in message
 
+	public static final int CRC_BLOCK_SIZE = 32;       // File block size used by CMD_FCRC
+	public static final int MAX_WINDOW_SIZE = 4;       // Maximum number of unacknowledged CMD_WRSEQ blocks
+
 	protected InputStream m_inputStream;
 	protected OutputStream m_outputStream;
 	protected int m_ioSpeed;
 	protected int m_recvInputTimeout;
 	protected int m_lastMsgID;
+	protected int m_windowSize;
 
 	public static final short CMD_NONE    = 0xFF;
 	public static final short CMD_FOPEN   = 0x70;
 	public static final short CMD_FCLOSE  = 0x71;
 	public static final short CMD_RWFILE  = 0x72;
+	public static final short CMD_FCRC    = 0x73;
+	public static final short CMD_FSEEK   = 0x74;
+	public static final short CMD_WRSEQ   = 0x75;
+	public static final short CMD_HSTAT   = 0x76;
 	public static final short CMD_RUNLVL  = 0x7E;
 
 	public static final byte RUNLVL_HALT   = 0x00;
@@ -129,12 +137,18 @@ class NVMComm2 {
 	public static class ResponseMessage {
 		public boolean m_error;
 		protected byte[] m_data;
+		protected int m_messageId;
 	
 		public boolean isError() { return m_error; } // error Response / normal Resonse
 		public byte[] getData() { return m_data; }   // response data or error info
+		public int getMessageId() { return m_messageId; } // id of the answered query
 		
 		public ResponseMessage(boolean isError, byte[] data) {
-				m_error = isError; m_data = data;
+				m_error = isError; m_data = data; m_messageId = -1;
+		}
+
+		public ResponseMessage(boolean isError, byte[] data, int messageId) {
+				m_error = isError; m_data = data; m_messageId = messageId;
 		}
 	}
 	
@@ -170,6 +184,8 @@ class NVMComm2 {
 	}
 	
 	
+	// Receive the response to query messageId, or to any query if
+	// messageId is -1.
 	public ResponseMessage receiveResponse(int messageId, CommBuffer buffer) {
 		final int NVC2_RECV_DROP   = 0;
 		final int NVC2_RECV_SEARCH = 1;
@@ -307,7 +323,7 @@ class NVMComm2 {
 						// crc error
 						return new ResponseMessage(true, null);
 					} else {
-						if (recvId == messageId) {
+						if ((recvId == messageId) || (messageId < 0)) {
 							// generate and return message
 							byte[] data = null;
 							if (msgLen > 3) {
@@ -316,7 +332,7 @@ class NVMComm2 {
 									data[i] = buffer.getData(i+3);
 							}
 		
-							return new ResponseMessage(errorMsg, data);
+							return new ResponseMessage(errorMsg, data, recvId);
 						} else {
 							// wrong message number, drop message
 							status = NVC2_RECV_DROP;
@@ -419,6 +435,180 @@ class NVMComm2 {
 		return executeQuery(address, read, command, dataArray, maxTries);
 	}
 
+
+	// CRC-16 of a file block, as computed by the target for CMD_FCRC
+	public static int blockCrc(byte[] file, int offset) {
+		int crc = 0xFFFF;
+		for (int i=0; i<CRC_BLOCK_SIZE; ++i)
+			crc = crc16ccittUpdateLsbf(0xFF & (int)file[offset+i], crc);
+		return crc;
+	}
+
+
+	// Read the CRCs of count blocks of the open file, starting at block
+	// first. Returns null if the target doesn't support CMD_FCRC.
+	public int[] readBlockCrcs(short address, int first, int count, int maxTries) {
+		int[] crcs = new int[count];
+
+		for (int i=0; i<count; ) {
+			int n = Math.min(count - i, MAX_DATA_LEN/2);
+			byte[] query = { (byte)(2*n), (byte)(first + i), (byte)((first + i) >> 8) };
+
+			ResponseMessage response = executeQuery(address, true, CMD_FCRC, query, maxTries);
+			if ((response == null) || response.isError()
+				|| (response.getData() == null) || (response.getData().length != 2*n))
+				return null;
+
+			byte[] data = response.getData();
+			for (int j=0; j<n; ++j, ++i)
+				crcs[i] = (0xFF & (int)data[2*j]) | ((0xFF & (int)data[2*j+1]) << 8);
+		}
+
+		return crcs;
+	}
+
+
+	// Read count heap counters, starting at counter first. Returns null
+	// if the target doesn't support CMD_HSTAT.
+	public long[] readHeapStats(short address, int first, int count, int maxTries) {
+		long[] stats = new long[count];
+
+		for (int i=0; i<count; ) {
+			int n = Math.min(count - i, MAX_DATA_LEN/4);
+			byte[] query = { (byte)(4*n), (byte)(first + i) };
+
+			ResponseMessage response = executeQuery(address, true, CMD_HSTAT, query, maxTries);
+			if ((response == null) || response.isError()
+				|| (response.getData() == null) || (response.getData().length != 4*n))
+				return null;
+
+			byte[] data = response.getData();
+			for (int j=0; j<n; ++j, ++i)
+				for (int k=3; k>=0; --k)
+					stats[i] = (stats[i] << 8) | (0xFF & (int)data[4*j+k]);
+		}
+
+		return stats;
+	}
+
+
+	// Set the read/write position in the open file
+	public boolean seekFile(short address, int pos, int maxTries) {
+		byte[] query = { (byte)pos, (byte)(pos >> 8) };
+		ResponseMessage response = executeQuery(address, false, CMD_FSEEK, query, maxTries);
+		return (response != null) && !response.isError();
+	}
+
+
+	// Write length bytes of file, starting at offset, at the current position
+	// of the open file
+	public boolean writeFile(short address, byte[] file, int offset, int length, int maxTries) {
+		for (int pos=offset; pos<offset+length; pos+=MAX_DATA_LEN) {
+			byte[] query = new byte[Math.min(MAX_DATA_LEN, offset + length - pos)];
+			System.arraycopy(file, pos, query, 0, query.length);
+
+			ResponseMessage response = executeQuery(address, false, CMD_RWFILE, query, maxTries);
+			if ((response == null) || response.isError()) return false;
+		}
+
+		return true;
+	}
+
+
+	// Write length bytes of file, starting at offset, to position pos of the
+	// open file. Up to m_windowSize CMD_WRSEQ blocks are sent without
+	// waiting for a response, each response acknowledges all blocks up to
+	// the one it names. If the acknowledges stop, transmission goes back to
+	// the first unacknowledged block.
+	public boolean streamFile(short address, int pos, byte[] file, int offset,
+		int length, int maxTries)
+	{
+		// FSEEK sets the target's block counter to the next message id
+		if (!seekFile(address, pos, maxTries)) return false;
+
+		final int first = m_lastMsgID + 1;
+		final int blocks = (length + MAX_DATA_LEN - 1) / MAX_DATA_LEN;
+		CommBuffer buffer = new CommBuffer(0xFF);
+		int acked = 0, sent = 0, tries = 0;
+
+		while (acked < blocks) {
+			// fill the window
+			for (; (sent < blocks) && (sent - acked < m_windowSize); ++sent) {
+				int start = offset + sent*MAX_DATA_LEN;
+				byte[] data = new byte[Math.min(MAX_DATA_LEN, offset + length - start)];
+				System.arraycopy(file, start, data, 0, data.length);
+				sendQuery(first + sent, new QueryMessage(address, false, CMD_WRSEQ, data));
+			}
+
+			ResponseMessage response = receiveResponse(-1, buffer);
+			if (response == null) {
+				// timeout, go back to the first unacknowledged block
+				if ((maxTries != 0) && (++tries >= maxTries)) return false;
+				sent = acked;
+			} else if (!response.isError()) {
+				byte[] data = response.getData();
+				if ((data == null) || (data.length != 1)) continue;
+
+				// number of blocks newly acknowledged, stale and
+				// duplicate acknowledges are ignored
+				int count = 0x07 & ((int)data[0] - (first + acked - 1));
+				if ((count > 0) && (count <= sent - acked)) {
+					acked += count;
+					tries = 0;
+				}
+			} else if ((response.getData() != null) && (response.getData().length > 0)) {
+				// error response, target refused the write
+				return false;
+			}
+		}
+
+		m_lastMsgID = 0x07 & (first + blocks - 1);
+		return true;
+	}
+
+
+	// Set the number of CMD_WRSEQ blocks in flight. Window times message
+	// size must fit into the receive buffer of the target.
+	public void setWindowSize(int size) {
+		m_windowSize = Math.max(1, Math.min(size, MAX_WINDOW_SIZE));
+	}
+
+
+	// Write the first length bytes of file to the freshly opened file,
+	// skipping all blocks whose CRC shows that the target already has them.
+	// The trailing partial block is always written. Falls back to writing
+	// everything if the target doesn't support CMD_FCRC. Returns the number
+	// of bytes sent or -1 on error.
+	public int deltaWriteFile(short address, byte[] file, int length, int maxTries) {
+		int blocks = length / CRC_BLOCK_SIZE;
+		int[] crcs = readBlockCrcs(address, 0, blocks, maxTries);
+
+		if (crcs == null)
+			return writeFile(address, file, 0, length, maxTries) ? length : -1;
+
+		int sent = 0;
+		int block = 0;
+		while (block*CRC_BLOCK_SIZE < length) {
+			if ((block < blocks) && (blockCrc(file, block*CRC_BLOCK_SIZE) == crcs[block]))
+				{ ++block; continue; }
+
+			// send a run of differing blocks in one go
+			int start = block;
+			do ++block;
+			while ( (block*CRC_BLOCK_SIZE < length) && ( (block >= blocks)
+				|| (blockCrc(file, block*CRC_BLOCK_SIZE) != crcs[block]) ) );
+
+			int pos = start*CRC_BLOCK_SIZE;
+			int len = Math.min(block*CRC_BLOCK_SIZE, length) - pos;
+
+			if (!streamFile(address, pos, file, pos, len, maxTries)) return -1;
+			sent += len;
+		}
+
+		return sent;
+	}
+
+
 	
 	public NVMComm2(InputStream inputStream, OutputStream outputStream, int ioSpeed) {
 		m_inputStream = inputStream;
@@ -426,5 +616,6 @@ class NVMComm2 {
 		m_ioSpeed = ioSpeed;
 		m_recvInputTimeout = NVC2_TIMEOUT_CHARS*(10000/ioSpeed) + 1;
 		m_lastMsgID = 0;
+		m_windowSize = 2;
 	}
 }
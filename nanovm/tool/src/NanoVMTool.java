@@ -26,16 +26,26 @@ public class NanoVMTool {
     System.out.println("Options:");
     System.out.println("    -c        write c header file");
     System.out.println("    -f name   force output file name");
+    System.out.println("    -b        build resident library from class[,class...]");
+    System.out.println("    -l class[,class...]  link against resident library");
+    System.out.println("  or: NanoVMTool -t trace [map]   decode a NanoVM trace file");
   }
   
   public static void main(String[] args) {
     int curArg = 0;
     boolean writeHeader = false;
     String outputFileName = null;
+    String libraryClasses = null;
 
     System.out.println("NanoVMTool " + Version.version + 
 		       " - (c) 2005-2007 by Till Harbaum");
 
+    // decode an instruction trace of the unix vm
+    if((args.length >= 2) && args[0].equals("-t")) {
+      TraceDecoder.decode(args[1], (args.length > 2)?args[2]:null);
+      return;
+    }
+
     // parse options
     while((args.length > curArg) && (args[curArg].charAt(0) == '-')) {
       switch(args[curArg].charAt(1)) {
@@ -47,6 +57,14 @@ public class NanoVMTool {
 	  outputFileName = args[++curArg];
 	  break;
 
+	case 'b':
+	  ClassLoader.setBuildLibrary();
+	  break;
+
+	case 'l':
+	  libraryClasses = args[++curArg];
+	  break;
+
 	default:
 	  System.out.println("Unknown option " + args[curArg]);
 	  usage();
@@ -70,7 +88,17 @@ public class NanoVMTool {
       Config.overwriteFileName(outputFileName);
 
     ClassLoader.setClassPath(args[curArg+1]);
-    ClassLoader.load(args[curArg+2]);    
+
+    // resident library classes always come first
+    if(ClassLoader.isBuildLibrary())
+      ClassLoader.loadLibrary(args[curArg+2]);
+    else {
+      if(libraryClasses != null)
+	ClassLoader.loadLibrary(libraryClasses);
+
+      ClassLoader.load(args[curArg+2]);    
+      ClassLoader.checkImageClasses();
+    }
 
     System.out.println("Successfully loaded " + 
 		       ClassLoader.totalClasses() + " classes");
@@ -0,0 +1,169 @@
+//
+//  NanoVMTool, Converter and Upload Tool for the NanoVM
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Parts of this tool are based on public domain code written by Kimberley
+//  Burchett: http://www.kimbly.com/code/classfile/
+//
+
+//
+// TraceDecoder.java
+//
+// Prints the instruction trace written by the unix NanoVM (-t option).
+// With the symbol map of the nvm file the methods are printed by name
+// together with the source line.
+//
+
+import java.io.*;
+import java.util.*;
+
+public class TraceDecoder {
+  static final String[] opcodes = {
+    "nop", "aconst_null", "iconst_m1", "iconst_0", "iconst_1", "iconst_2",
+    "iconst_3", "iconst_4", "iconst_5", "lconst_0", "lconst_1", "fconst_0",
+    "fconst_1", "fconst_2", "dconst_0", "dconst_1", "bipush", "sipush",
+    "ldc", "ldc_w", "ldc2_w", "iload", "lload", "fload", "dload", "aload",
+    "iload_0", "iload_1", "iload_2", "iload_3", "lload_0", "lload_1",
+    "lload_2", "lload_3", "fload_0", "fload_1", "fload_2", "fload_3",
+    "dload_0", "dload_1", "dload_2", "dload_3", "aload_0", "aload_1",
+    "aload_2", "aload_3", "iaload", "laload", "faload", "daload", "aaload",
+    "baload", "caload", "saload", "istore", "lstore", "fstore", "dstore",
+    "astore", "istore_0", "istore_1", "istore_2", "istore_3", "lstore_0",
+    "lstore_1", "lstore_2", "lstore_3", "fstore_0", "fstore_1", "fstore_2",
+    "fstore_3", "dstore_0", "dstore_1", "dstore_2", "dstore_3", "astore_0",
+    "astore_1", "astore_2", "astore_3", "iastore", "lastore", "fastore",
+    "dastore", "aastore", "bastore", "castore", "sastore", "pop", "pop2",
+    "dup", "dup_x1", "dup_x2", "dup2", "dup2_x1", "dup2_x2", "swap", "iadd",
+    "ladd", "fadd", "dadd", "isub", "lsub", "fsub", "dsub", "imul", "lmul",
+    "fmul", "dmul", "idiv", "ldiv", "fdiv", "ddiv", "irem", "lrem", "frem",
+    "drem", "ineg", "lneg", "fneg", "dneg", "ishl", "lshl", "ishr", "lshr",
+    "iushr", "lushr", "iand", "land", "ior", "lor", "ixor", "lxor", "iinc",
+    "i2l", "i2f", "i2d", "l2i", "l2f", "l2d", "f2i", "f2l", "f2d", "d2i",
+    "d2l", "d2f", "i2b", "i2c", "i2s", "lcmp", "fcmpl", "fcmpg", "dcmpl",
+    "dcmpg", "ifeq", "ifne", "iflt", "ifge", "ifgt", "ifle", "if_icmpeq",
+    "if_icmpne", "if_icmplt", "if_icmpge", "if_icmpgt", "if_icmple",
+    "if_acmpeq", "if_acmpne", "goto", "jsr", "ret", "tableswitch",
+    "lookupswitch", "ireturn", "lreturn", "freturn", "dreturn", "areturn",
+    "return", "getstatic", "putstatic", "getfield", "putfield",
+    "invokevirtual", "invokespecial", "invokestatic", "invokeinterface",
+    "xxxunusedxxx", "new", "newarray", "anewarray", "arraylength", "athrow",
+    "checkcast", "instanceof", "monitorenter", "monitorexit", "wide",
+    "multianewarray", "ifnull", "ifnonnull", "goto_w", "jsr_w"
+  };
+
+  Hashtable methods = new Hashtable();   // mref -> name
+  Hashtable lines = new Hashtable();     // mref -> Vector of int[] {pc, line}
+
+  static String opcodeName(int op) {
+    return (op < opcodes.length)?opcodes[op]:("0x" + Integer.toHexString(op));
+  }
+
+  // read method and line records of a symbol map
+  void loadMap(String fileName) throws IOException {
+    BufferedReader in = new BufferedReader(new FileReader(fileName));
+    String line;
+
+    while((line = in.readLine()) != null) {
+      StringTokenizer st = new StringTokenizer(line);
+      if(!st.hasMoreTokens()) continue;
+      String type = st.nextToken();
+
+      if(type.equals("method") && (st.countTokens() == 4)) {
+	Integer mref = Integer.valueOf(st.nextToken());
+	st.nextToken();  // file offset
+	st.nextToken();  // code length
+	methods.put(mref, st.nextToken());
+      } else if(type.equals("line") && (st.countTokens() == 3)) {
+	Integer mref = Integer.valueOf(st.nextToken());
+	int[] entry = { Integer.parseInt(st.nextToken()),
+			Integer.parseInt(st.nextToken()) };
+	if(lines.get(mref) == null)
+	  lines.put(mref, new Vector());
+	((Vector)lines.get(mref)).addElement(entry);
+      }
+    }
+    in.close();
+  }
+
+  // source line of a bytecode offset or -1
+  int sourceLine(int mref, int pc) {
+    Vector v = (Vector)lines.get(new Integer(mref));
+    int start = -1, line = -1;
+
+    for(int i=0;(v != null) && (i<v.size());i++) {
+      int[] entry = (int[])v.elementAt(i);
+      if((entry[0] <= pc) && (entry[0] > start)) {
+	start = entry[0];
+	line = entry[1];
+      }
+    }
+    return line;
+  }
+
+  static int read16(DataInputStream in) throws IOException {
+    int lo = in.readUnsignedByte();
+    return lo | (in.readUnsignedByte() << 8);
+  }
+
+  void decode(String fileName) throws IOException {
+    DataInputStream in = new DataInputStream(
+      new BufferedInputStream(new FileInputStream(fileName)));
+
+    byte[] magic = new byte[4];
+    in.readFully(magic);
+    if(!new String(magic).equals("NVMT"))
+      throw new IOException("not a NanoVM trace file");
+
+    int size = in.readUnsignedByte();
+    long total = read16(in) | ((long)read16(in) << 16);
+    int records = (int)((new File(fileName).length() - 9) / size);
+    long seq = total - records;
+
+    System.out.println(total + " instructions executed, last " +
+		       records + " recorded");
+
+    for(int i=0;i<records;i++,seq++) {
+      int mref = read16(in);
+      int pc = read16(in);
+      int op = in.readUnsignedByte();
+      int depth = in.readUnsignedByte();
+      in.skipBytes(size - 6);
+
+      String name = (String)methods.get(new Integer(mref));
+      int line = sourceLine(mref, pc);
+
+      System.out.println(seq + ": " +
+			 ((name != null)?name:("method " + mref)) +
+			 " pc " + pc + ((line >= 0)?(" (line " + line + ")"):"") +
+			 " sp " + depth + " " + opcodeName(op));
+    }
+    in.close();
+  }
+
+  public static void decode(String traceFile, String mapFile) {
+    TraceDecoder decoder = new TraceDecoder();
+
+    try {
+      if(mapFile != null)
+	decoder.loadMap(mapFile);
+      decoder.decode(traceFile);
+    } catch(IOException e) {
+      System.out.println("Error reading trace: " + e.toString());
+      System.exit(-1);
+    }
+  }
+}
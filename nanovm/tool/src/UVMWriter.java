@@ -31,9 +31,16 @@ public class UVMWriter {
   static final int MAGIC   = 0xBE000000;
   static final int VERSION = 2;
 
+  // method header flags
+  static final int FLAG_CLINIT = 1;
+  static final int FLAG_IMPORT = 2;
+
   byte[] outputBuffer;
   int cur;
 
+  // symbol map written next to the nvm file
+  StringBuffer symbols = new StringBuffer();
+
   // write a 8 bit value into buffer and make sure buffer
   // end is not overwritten
   void write8(int val) throws ConvertException {
@@ -68,13 +75,26 @@ public class UVMWriter {
   void writeHeader() throws ConvertException {
     int offset = 15;    // header size: 15 bytes
 
+    if(ClassLoader.usesLibrary()) {
+      UsedFeatures.add(UsedFeatures.LIBRARY);
+
+      // application and library share the class ids below native ones
+      if(ClassLoader.imageClasses() > ClassLoader.LIBRARY_CLASS_BASE)
+	throw new ConvertException("Too many classes for library setup");
+    }
+
     write32(MAGIC|UsedFeatures.get());
     write8(VERSION);
-    write8(ClassLoader.totalMethods());
-    write16(ClassLoader.getMainIndex());
+    write8(ClassLoader.imageMethods() + ClassLoader.totalImports());
+
+    // a library has no main method, it carries its id instead
+    if(ClassLoader.isBuildLibrary())
+      write16(ClassLoader.getLibraryId());
+    else
+      write16(ClassLoader.getMainIndex());
 
     // offset to constant data
-    offset += 2 * ClassLoader.totalClasses(); // class header size: 2bytes
+    offset += 2 * ClassLoader.imageClasses(); // class header size: 2bytes
     write16(offset);
     
     // offset to string data
@@ -90,8 +110,8 @@ public class UVMWriter {
 
   // write all class headers
   void writeClassHeaders() throws ConvertException {
-    for(int i=0;i<ClassLoader.totalClasses();i++) {
-      ClassInfo classInfo = ClassLoader.getClassInfo(i);
+    for(int i=0;i<ClassLoader.imageClasses();i++) {
+      ClassInfo classInfo = ClassLoader.getImageClassInfo(i);
 
       write8(classInfo.getSuperClassIndex());
       write8(classInfo.nonStaticFields());
@@ -104,9 +124,30 @@ public class UVMWriter {
     for(int i=0;i<ClassLoader.totalConstantEntries();i++) {
       System.out.println("  entry[" + i + "] = 0x" + Integer.toHexString(ClassLoader.getConstantEntry(i)));
       write32(ClassLoader.getConstantEntry(i));
+      symbols.append("const " + i + " 0x" +
+		     Integer.toHexString(ClassLoader.getConstantEntry(i)) + "\n");
     }
   }
 
+  // strings in the symbol map are escaped to stay on a single line
+  static String escape(String str) {
+    StringBuffer res = new StringBuffer();
+    for(int i=0;i<str.length();i++) {
+      char c = str.charAt(i);
+      if(c == '\\')      res.append("\\\\");
+      else if(c == '\n') res.append("\\n");
+      else if(c == '\r') res.append("\\r");
+      else if(c == '\t') res.append("\\t");
+      else               res.append(c);
+    }
+    return res.toString();
+  }
+
+  static String methodName(ClassInfo classInfo, MethodInfo methodInfo) {
+    return classInfo.getName() + "." + methodInfo.getName() + ":" +
+      methodInfo.getSignature();
+  }
+
   // write all string headers and data 
   void writeStrings() throws ConvertException {
     System.out.println("Writing " + ClassLoader.totalStrings() + " strings");
@@ -126,26 +167,30 @@ public class UVMWriter {
       // write zero terminated c strings
       for(int j=0;j<str.length();j++) write8(str.charAt(j));
       write8(0);
+
+      symbols.append("string " + (i+ClassLoader.totalConstantEntries()) +
+		     " " + escape(str) + "\n");
     }
   }
 
   // write all methods
   void writeMethods() throws ConvertException {
+    int methods = ClassLoader.imageMethods() + ClassLoader.totalImports();
     int codeOffset = 0;
 
     // build the method id table
     MethodIdTable.build();
       
     // write all Method headers
-    for(int i=0;i<ClassLoader.totalMethods();i++) {
-      MethodInfo methodInfo = ClassLoader.getMethod(i);
+    for(int i=0;i<ClassLoader.imageMethods();i++) {
+      MethodInfo methodInfo = ClassLoader.getImageMethod(i);
       
       // offset from this header to bytecode (this header is 8 bytes
       // in size)
-      write16((ClassLoader.totalMethods()-i)*8+codeOffset);      // code_index 
-      write16((ClassLoader.getClassIndex(i) << 8) + 
-	      MethodIdTable.getEntry(i));                        // id
-      write8(methodInfo.getName().equals("<clinit>")?1:0);       // flags
+      write16((methods-i)*8+codeOffset);                         // code_index 
+      write16((ClassLoader.getImageClassIndex(i) << 8) + 
+	      ClassLoader.getImageMethodId(i));                  // id
+      write8(methodInfo.getName().equals("<clinit>")?FLAG_CLINIT:0); // flags
       write8(methodInfo.getArgs());                              // args
       write8(methodInfo.getCodeInfo().getMaxLocals());           // max_locals
       write8(methodInfo.getCodeInfo().getMaxStack());            // max_stack
@@ -153,17 +198,45 @@ public class UVMWriter {
       codeOffset += methodInfo.getCodeInfo().getBytecode().length;
     }
 
+    // write import table, one header without code for every library
+    // method used. The vm resolves these by class and method id
+    for(int i=0;i<ClassLoader.totalImports();i++) {
+      int index = ClassLoader.getImport(i);
+
+      write16(ClassLoader.getLibraryId());                       // library id
+      write16((ClassLoader.getImportClassIndex(i) << 8) + 
+	      MethodIdTable.getEntry(index));                    // id
+      write8(FLAG_IMPORT);                                       // flags
+      write8(ClassLoader.getMethod(index).getArgs());            // args
+      write8(0);                                                 // max_locals
+      write8(0);                                                 // max_stack
+
+      symbols.append("import " + (ClassLoader.imageMethods()+i) + " " +
+		     methodName(ClassLoader.getClassInfo(
+		       ClassLoader.getClassIndex(index)),
+				ClassLoader.getMethod(index)) + "\n");
+    }
+
     // write bytecode
-    for(int i=0;i<ClassLoader.totalMethods();i++) {
-      ClassInfo classInfo = ClassLoader.getClassInfoFromMethodIndex(i);
-      MethodInfo methodInfo = ClassLoader.getMethod(i);
+    for(int i=0;i<ClassLoader.imageMethods();i++) {
+      ClassInfo classInfo = ClassLoader.getImageClassInfoFromMethodIndex(i);
+      MethodInfo methodInfo = ClassLoader.getImageMethod(i);
 
       System.out.println("Converting " + 
 			 classInfo.getName() + "." +
 			 methodInfo.getName() + ":" +
 			 methodInfo.getSignature());
 
-      byte code[] = ClassLoader.getMethod(i).getCodeInfo().getBytecode();
+      byte code[] = methodInfo.getCodeInfo().getBytecode();
+
+      // file offset and size of the bytecode and the source lines
+      symbols.append("method " + i + " " + cur + " " + code.length + " " +
+		     methodName(classInfo, methodInfo) + "\n");
+
+      LineNumberInfo lines[] = methodInfo.getCodeInfo().getLineNumberTable();
+      for(int j=0;(lines != null) && (j<lines.length);j++)
+	symbols.append("line " + i + " " + lines[j].startPC + " " +
+		       lines[j].lineNumber + "\n");
 
       // adjust references etc
       CodeTranslator.translate(classInfo, code);
@@ -176,6 +249,21 @@ public class UVMWriter {
     }
   }
 
+  // write the symbol map, e.g. Fibonacci.map for Fibonacci.nvm. It
+  // lets the unix vm print method names and source lines
+  void writeSymbols(String fileName) throws IOException {
+    if(fileName.endsWith(".nvm"))
+      fileName = fileName.substring(0, fileName.length()-4);
+    fileName += ".map";
+
+    System.out.println("Writing symbols to file " + fileName);
+    FileOutputStream out = new FileOutputStream(new File(fileName));
+    out.write(("# NanoVM symbol map, methods are numbered like in the " +
+	       "nvm file\n").getBytes());
+    out.write(symbols.toString().getBytes());
+    out.close();
+  }
+
   public UVMWriter(boolean writeHeader) {
     System.out.println("Generating unified class file ...");
 
@@ -183,6 +271,9 @@ public class UVMWriter {
     outputBuffer = new byte[Config.getMaxSize()];
     cur = 0;
 
+    // library methods called by the application
+    ClassLoader.collectImports();
+
     try {
       writeHeader();           // write file header
       writeClassHeaders();     // write class headers
@@ -195,7 +286,7 @@ public class UVMWriter {
       if(writeHeader) {
 	System.out.println("Writing C header file");
 
-	String fileName = ClassLoader.getClassInfo(0).getName()+".h";
+	String fileName = ClassLoader.getImageClassInfo(0).getName()+".h";
 	// if a file name has been specified in the Config file or via the
 	// command line use that
 	if(Config.getFileName() != null)
@@ -208,7 +299,7 @@ public class UVMWriter {
 	  FileOutputStream out = new FileOutputStream(outputFile);
 
 	  out.write(("/* " + fileName + ", autogenerated from " + 
-		     ClassLoader.getClassInfo(0).getName() + 
+		     ClassLoader.getImageClassInfo(0).getName() + 
 		     " class */\n").getBytes());
 
 	  out.write("{\n".getBytes());
@@ -242,7 +333,7 @@ public class UVMWriter {
 	  case Config.TARGET_FILE:
 	    // write file to disk
 	    try {
-	      String fileName = ClassLoader.getClassInfo(0).getName()+".nvm";
+	      String fileName = ClassLoader.getImageClassInfo(0).getName()+".nvm";
 	      // if a file name has been specified in the Config file or 
 	      // via the command line use that
 	      if(Config.getFileName() != null)
@@ -253,6 +344,8 @@ public class UVMWriter {
 	      FileOutputStream out = new FileOutputStream(outputFile);
 	      out.write(outputBuffer, 0, cur);
 	      out.close();
+
+	      writeSymbols(fileName);
 	    } catch(IOException e) {
 	      System.out.println("Error writing file: " + e.toString());
 	      System.exit(-1);
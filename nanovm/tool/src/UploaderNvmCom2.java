@@ -0,0 +1,184 @@
+//
+//  NanoVMTool, Converter and Upload Tool for the NanoVM
+//  Copyright (C) 2005-2006 by Till Harbaum <Till@Harbaum.org>
+//                             Oliver Schulz <whisp@users.sf.net>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//  Parts of this tool are based on public domain code written by Kimberley
+//  Burchett: http://www.kimbly.com/code/classfile/
+//
+
+import java.io.*;
+import java.util.*;
+import gnu.io.*;
+
+
+public class UploaderNvmCom2 extends Uploader {
+	static final short TARGET_ADDRESS = 0x10;
+	static final int MAX_TRIES = 10;
+
+	static Enumeration portList;
+	static CommPortIdentifier portId;
+	static SerialPort serialPort;
+	static OutputStream outputStream;
+	static InputStream inputStream;
+
+
+	static void sleep(int ms) {
+		try {
+			Thread.currentThread().sleep(ms);
+		} catch (Exception e) {}
+	}
+
+
+	static boolean runlevel(NVMComm2 comm, byte level, String name) {
+		System.out.println("Info: Setting target runlevel to " + name + ".");
+		NVMComm2.ResponseMessage response = comm.executeQuery(TARGET_ADDRESS,
+			false, NVMComm2.CMD_RUNLVL, level, MAX_TRIES);
+		return (response != null) && !response.isError();
+	}
+
+
+	static boolean openFirmware(NVMComm2 comm) {
+		System.out.println("Info: Opening target firmware.");
+		NVMComm2.ResponseMessage response = comm.executeQuery(TARGET_ADDRESS,
+			false, NVMComm2.CMD_FOPEN, (byte)0, MAX_TRIES);
+		return (response != null) && !response.isError();
+	}
+
+
+	static void closeFirmware(NVMComm2 comm) {
+		System.out.println("Info: Closing target firmware.");
+		comm.executeQuery(TARGET_ADDRESS, false, NVMComm2.CMD_FCLOSE, (byte)0, MAX_TRIES);
+	}
+
+
+	static boolean verifyFirmware(NVMComm2 comm, byte[] file, int length) {
+		for (int pos=0; pos<length; ) {
+			int size = Math.min(NVMComm2.MAX_DATA_LEN, length - pos);
+			System.out.println("Info: Reading firmware bytes " + Integer.toHexString(pos)
+				+ " to " + Integer.toHexString(pos + size - 1));
+
+			NVMComm2.ResponseMessage response = comm.executeQuery(TARGET_ADDRESS,
+				true, NVMComm2.CMD_RWFILE, (byte)size, MAX_TRIES);
+			if ((response == null) || response.isError() || (response.getData() == null)) {
+				System.out.println("Info: Error reading firmware!");
+				return false;
+			}
+
+			byte[] data = response.getData();
+			for (int i=0; (i<data.length) && (pos<length); ++i, ++pos) {
+				if (data[i] != file[pos]) {
+					System.out.println("Info: Firmware verify failed at byte 0x"
+						+ Integer.toHexString(pos) + " : "
+						+ Integer.toHexString(0xFF & file[pos]) + " != "
+						+ Integer.toHexString(0xFF & data[i]));
+					return false;
+				}
+			}
+		}
+
+		return true;
+	}
+
+
+	public void doUpload(String device, int target, int speed, byte[] file, int length) {
+		boolean portFound = false;
+
+		portList = CommPortIdentifier.getPortIdentifiers();
+
+		while (portList.hasMoreElements()) {
+			portId = (CommPortIdentifier) portList.nextElement();
+			if ( (portId.getPortType() != CommPortIdentifier.PORT_SERIAL)
+				|| !portId.getName().equals(device) ) continue;
+
+			System.out.println("Found port " + device);
+			portFound = true;
+
+			try {
+				serialPort = (SerialPort) portId.open("Uploader", 2000);
+			} catch (PortInUseException e) {
+				System.out.println("Port in use.");
+				continue;
+			}
+
+			try {
+				outputStream = serialPort.getOutputStream();
+				inputStream = serialPort.getInputStream();
+				serialPort.setSerialPortParams(speed, SerialPort.DATABITS_8,
+					SerialPort.STOPBITS_1, SerialPort.PARITY_NONE);
+			} catch (Exception e) {
+				System.out.println("Error setting up serial port");
+				System.out.println(e.toString());
+				serialPort.close();
+				System.exit(-1);
+			}
+
+			System.out.println("Using NanoVM Communication Protocol v2.0");
+			NVMComm2 comm = new NVMComm2(inputStream, outputStream, speed);
+
+			boolean targetFound = false;
+			System.out.print("Info: Looking for target system");
+			for (int i=0; (i<10000) && !targetFound; ++i) {
+				NVMComm2.ResponseMessage response = comm.executeQuery(TARGET_ADDRESS,
+					false, NVMComm2.CMD_NONE, null, 1);
+				targetFound = (response != null) && !response.isError();
+				if (!targetFound) {
+					sleep(100);
+					System.out.print(" .");
+				}
+			}
+			System.out.println("");
+
+			if (!targetFound) {
+				System.out.println("Error: Target system not responding");
+			} else {
+				System.out.println("Info: Target system found");
+
+				runlevel(comm, NVMComm2.RUNLVL_CONF, "conf");
+				openFirmware(comm);
+
+				// only send the blocks that differ from the installed firmware
+				System.out.println("Info: Writing firmware bytes 0 to "
+					+ Integer.toHexString(length - 1));
+				int sent = comm.deltaWriteFile(TARGET_ADDRESS, file, length, MAX_TRIES);
+				if (sent < 0)
+					System.out.println("Info: Error writing firmware!");
+				else
+					System.out.println("Info: " + sent + " of " + length
+						+ " bytes differed from target firmware.");
+
+				closeFirmware(comm);
+
+				runlevel(comm, NVMComm2.RUNLVL_RESET, "reset");
+				sleep(200);
+
+				runlevel(comm, NVMComm2.RUNLVL_CONF, "conf");
+				openFirmware(comm);
+				System.out.println("Info: Checking target firmware.");
+				verifyFirmware(comm, file, length);
+				closeFirmware(comm);
+
+				runlevel(comm, NVMComm2.RUNLVL_HALT, "halt");
+			}
+
+			serialPort.close();
+		}
+
+		if (!portFound)
+			System.out.println("Port " + device + " not found.");
+	}
+}
@@ -34,6 +34,8 @@ public class UsedFeatures {
   static final int ARRAY        = (1<<4);
   static final int INHERITANCE  = (1<<5);
   static final int EXTSTACK     = (1<<6);
+  static final int LIBRARY      = (1<<7);
+  static final int RAWFLOAT     = (1<<8);
 
   private static int features;
 
@@ -42,6 +44,10 @@ public class UsedFeatures {
   }
   
   public static int get(){
+    // floats of a raw float target are plain ieee bits
+    if(Config.useRawFloat() && ((features & FLOAT) != 0))
+      features |= RAWFLOAT;
+
     System.out.println("Feature value is 0x"+Integer.toHexString(features));
     return features;
   }
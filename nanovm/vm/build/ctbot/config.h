@@ -38,9 +38,14 @@
 #define NVM_USE_32BIT_WORD
 #define NVM_USE_FLOAT
 #define NVM_USE_EXTSTACKOPS      // enable extended dup opcodes
+#define NVM_USE_LIBRARY          // resident driver classes (LIBRARY in Makefile)
+#define NVMLIB_IMPORTS 16        // library methods an application may call
 
 // native setup
 #define NVM_USE_MATH             // enable native math functions
+#define NVM_USE_ARRAYMATH        // enable native array math kernels
+#define NVM_USE_FIXED            // enable native Q16.16 fixed point class
+#define NVM_USE_HEAP_STATS       // heap counters, nanovm.lang.Runtime
 #define NVM_USE_STDIO            // enable native stdio support
 #define NVM_USE_FORMATTER        // enable native formatter class
 
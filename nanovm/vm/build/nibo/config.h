@@ -40,6 +40,9 @@
 
 // native setup
 #define NVM_USE_MATH             // enable native math functions
+#define NVM_USE_ARRAYMATH        // enable native array math kernels
+#define NVM_USE_FIXED            // enable native Q16.16 fixed point class
+#define NVM_USE_HEAP_STATS       // heap counters, nanovm.lang.Runtime
 #define NVM_USE_STDIO            // enable native stdio support
 #define NVM_USE_FORMATTER        // enable native formatter class
 
@@ -25,9 +25,13 @@
 #define NVM_USE_ARRAY            // enable arrays
 #define NVM_USE_SWITCH           // support switch instruction
 #define NVM_USE_INHERITANCE      // support for inheritance
+#define NVM_USE_THREADS          // green threads, nanovm.lang.Thread
+#define THREAD_MAX       4       // main() and three others
+#define THREAD_STACK     64      // 3*64 16 bit entries, 384 of the 20k ram
 
 // native setup
 #define NVM_USE_STDIO            // enable native stdio support
+#define NVM_USE_HEAP_STATS       // heap counters, nanovm.lang.Runtime
 
 // marker used to indicate, that this item is stored in eeprom
 #define NVMFILE_FLAG     0x8000
@@ -14,15 +14,32 @@
 // a named pipe (e.g. to test the loader code):
 // #define UART_PORT "/dev/ttyq0"
 
+// console output is buffered and flushed on newline, input and exit.
+// Define this to also flush output older than the given number of ms
+// #define UART_FLUSH_MS 100
+
 #define NVM_USE_STACK_CHECK      // enable check if method returns empty stack
 #define NVM_USE_ARRAY            // enable arrays
 #define NVM_USE_SWITCH           // support switch instructions
 #define NVM_USE_INHERITANCE      // support for inheritance
 #define NVM_USE_FLOAT            // floating point support
+#define NVM_USE_RAW_FLOAT        // keep floats as plain ieee bits on the stack
 #define NVM_USE_32BIT_WORD       // 32 bit integer
+#define NVM_USE_STATS            // count instructions, gc runs and heap usage
+#define NVM_USE_PROFILE          // -p: per opcode/method/native call profile
+#define NVM_USE_SYMBOLS          // method names and lines from the .map file
+#define NVM_USE_TRACE            // -t: ring buffer trace of the last instructions
+#define NVM_USE_SAMPLER          // -s: SIGPROF sampling profiler
+#define NVM_USE_LATENCY          // -L: latency histograms, nanovm.lang.Latency
+#define NVM_USE_CONTEXT          // -n: per thread vm state, several vms at once
+#define NVM_USE_SLICE            // run main() in slices, vm_run_slice()
+#define NVM_USE_THREADS          // green threads, nanovm.lang.Thread
 
 // native setup
 #define NVM_USE_MATH             // enable native math functions
+#define NVM_USE_ARRAYMATH        // enable native array math kernels
+#define NVM_USE_FIXED            // enable native Q16.16 fixed point class
+#define NVM_USE_HEAP_STATS       // heap counters, nanovm.lang.Runtime
 #define NVM_USE_STDIO            // enable native stdio support
 #define NVM_USE_FORMATTER        // enable native formatter class
 
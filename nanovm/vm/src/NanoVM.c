@@ -23,16 +23,29 @@
 
 #ifdef UNIX
 #include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
 #endif // UNIX
 
 #include "types.h"
 #include "config.h"
 #include "debug.h"
 
+#ifdef NVM_USE_CONTEXT
+#include <pthread.h>
+#endif
+
 #include "loader.h"
+#include "nvmcomm2.h"
 #include "uart.h"
 #include "nvmfile.h"
 #include "vm.h"
+#include "profile.h"
+#include "symbols.h"
+#include "trace.h"
+#include "sampler.h"
+#include "latency.h"
 
 // hooks for init routines
 
@@ -53,6 +66,90 @@
 #include "native_lcd.h"
 #endif
 
+#if defined(UNIX) && defined(NVM_USE_STATS)
+// -b: time main() and report the statistics as a single
+// machine readable line on stderr
+static struct timeval bench_wall;
+static clock_t bench_cpu;
+
+static void bench_start(void) {
+  bench_cpu = clock();
+  gettimeofday(&bench_wall, NULL);
+}
+
+static void bench_report(void) {
+  struct timeval now;
+  u32_t wall_us, cpu_us;
+
+  gettimeofday(&now, NULL);
+  cpu_us = (u32_t)((clock() - bench_cpu) * (1000000.0 / CLOCKS_PER_SEC));
+  wall_us = (now.tv_sec - bench_wall.tv_sec) * 1000000L +
+    (now.tv_usec - bench_wall.tv_usec);
+
+  fprintf(stderr, "instructions=%lu wall_us=%lu cpu_us=%lu ips=%lu "
+	  "gc=%u allocs=%lu heap_peak=%u heap_size=%u\n",
+	  (unsigned long)VM_STATS.instructions, (unsigned long)wall_us,
+	  (unsigned long)cpu_us, cpu_us ? (unsigned long)
+	  (VM_STATS.instructions * 1000000.0 / cpu_us) : 0ul,
+	  HEAP_STATISTICS.gc_runs, (unsigned long)HEAP_STATISTICS.allocs,
+	  HEAP_STATISTICS.used_peak, HEAPSIZE);
+}
+#endif
+
+#ifdef NVM_USE_CONTEXT
+// -n: run the file in several threads at once, each one
+// in a vm of its own
+static void *vm_thread(void *ctx) {
+  vm_context_set(ctx);
+
+  nvmfile_init();
+  vm_init();
+  nvmfile_call_main();
+
+  return NULL;
+}
+
+static void vm_threads(int count, char *filename) {
+  nvm_context_t *main_ctx = nvm_context;
+  nvm_context_t **ctx = calloc(count, sizeof(nvm_context_t*));
+  pthread_t *thread = calloc(count, sizeof(pthread_t));
+  int i;
+
+  if(!ctx || !thread) {
+    printf("Out of memory\n");
+    exit(-1);
+  }
+
+  // load the files here, a failure terminates all of them anyway
+  for(i=0;i<count;i++) {
+    if(!(ctx[i] = vm_context_new())) {
+      printf("Out of memory\n");
+      exit(-1);
+    }
+
+    vm_context_set(ctx[i]);
+    if(filename)
+      nvmfile_load(filename, TRUE);
+  }
+  vm_context_set(main_ctx);
+
+  for(i=0;i<count;i++) {
+    if(pthread_create(&thread[i], NULL, vm_thread, ctx[i])) {
+      perror("pthread_create()");
+      exit(-1);
+    }
+  }
+
+  for(i=0;i<count;i++) {
+    pthread_join(thread[i], NULL);
+    vm_context_free(ctx[i]);
+  }
+
+  free(thread);
+  free(ctx);
+}
+#endif
+
 int main(int argc, char **argv) {
 
 #ifndef CTBOT
@@ -69,7 +166,15 @@ int main(int argc, char **argv) {
 #ifdef UNIX
   // parse unix command line options and load 
   // nvm file if requested
-  int i = 1, quiet = 0;
+  int i = 1, quiet = 0, bench = 0;
+#ifdef NVM_USE_LATENCY
+  char *latency_names[LATENCY_METHODS];
+  int latency_count = 0;
+#endif
+#ifdef NVM_USE_CONTEXT
+  char *filename = NULL;
+  int threads = 1;
+#endif
 
   debug_enable(FALSE);  
 
@@ -81,6 +186,56 @@ int main(int argc, char **argv) {
     if(argv[i][1] == 'q')
       quiet = TRUE;
 
+#ifdef NVM_USE_STATS
+    if(argv[i][1] == 'b')
+      bench = TRUE;
+#endif
+
+#ifdef NVM_USE_PROFILE
+    // count opcodes, method and native calls, write json at exit
+    if((argv[i][1] == 'p') && (i+1 < argc))
+      profile_enable(argv[++i]);
+#endif
+
+#ifdef NVM_USE_TRACE
+    // keep the last instructions, write them to a file at exit
+    if((argv[i][1] == 't') && (i+1 < argc))
+      trace_enable(argv[++i]);
+#endif
+
+#ifdef NVM_USE_SAMPLER
+    // sample the running method on SIGPROF, write a report at exit
+    if((argv[i][1] == 's') && (i+1 < argc))
+      sampler_enable(argv[++i]);
+#endif
+
+#ifdef NVM_USE_LATENCY
+    // latency histograms, written to a file at exit
+    if((argv[i][1] == 'L') && (i+1 < argc))
+      latency_enable(argv[++i]);
+
+    // methods to time, by name or method index
+    if((argv[i][1] == 'm') && (i+1 < argc) &&
+       (latency_count < LATENCY_METHODS))
+      latency_names[latency_count++] = argv[++i];
+#endif
+
+#ifdef NVM_USE_CONTEXT
+    // number of vms to run in parallel
+    if((argv[i][1] == 'n') && (i+1 < argc))
+      threads = atoi(argv[++i]);
+#endif
+
+#ifdef NVM_USE_LIBRARY
+    // resident library the application is linked against
+    if((argv[i][1] == 'l') && (i+1 < argc)) {
+      nvmlib_load(argv[++i], quiet);
+#ifdef NVM_USE_SYMBOLS
+      symbols_load(argv[i], NVMLIB_METHOD_BASE);
+#endif
+    }
+#endif
+
     i++;
   }
 
@@ -90,22 +245,78 @@ int main(int argc, char **argv) {
   // load translated class file
   if((i<argc)&&(argv[i][0] != '-')) {
     nvmfile_load(argv[i], quiet);
+#ifdef NVM_USE_CONTEXT
+    filename = argv[i];
+#endif
+#ifdef NVM_USE_SYMBOLS
+    // method names and source lines from the map next to the file
+    symbols_load(argv[i], 0);
+#endif
   } else 
     printf("running pre-installed default\n");
+
+#ifdef NVM_USE_LATENCY
+  // the names are only known after the maps have been loaded
+  while(latency_count--) {
+    char *name = latency_names[latency_count];
+    u16_t mref = LATENCY_NONE;
+    if((name[0] >= '0') && (name[0] <= '9'))
+      mref = atoi(name);
+#ifdef NVM_USE_SYMBOLS
+    else
+      mref = symbols_find(name);
+#endif
+    if(mref == LATENCY_NONE)
+      printf("unknown method %s\n", name);
+    else
+      latency_select(latency_count, mref);
+  }
+#endif
 #endif // UNIX
 
 #ifndef CTBOT
 #ifndef NIBO
+#ifdef UNIX
+  // benchmarks always run the file given, don't wait for an upload
+  if(!bench)
+#endif
   // wait 1 sec for upload
   loader_receive();
 #endif
 #endif
 
+#ifdef NVM_USE_CONTEXT
+  if(threads > 1) {
+    vm_threads(threads, filename);
+    return 0;
+  }
+#endif
+
   nvmfile_init();
 
   vm_init();
 
+#if defined(UNIX) && defined(NVM_USE_STATS)
+  if(bench)
+    bench_start();
+#endif
+
+#ifdef NVM_USE_SLICE
+  // run main() in slices, the link is serviced in between
+  nvmfile_start_main();
+  while(vm_run_slice(VM_SLICE_BYTECODES, NULL)) {
+#ifdef NVMCOMM2
+    nvc2_poll();
+#endif
+  }
+#else
   nvmfile_call_main();
+#endif
+
+#if defined(UNIX) && defined(NVM_USE_STATS)
+  if(bench)
+    bench_report();
+#endif
 
 #ifdef UNIX
   // the following is only being done to detect memory leaks and
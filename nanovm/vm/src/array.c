@@ -26,6 +26,8 @@
 #include "array.h"
 #include "heap.h"
 
+#include <string.h>
+
 #ifdef NVM_USE_ARRAY
 
 u08_t array_typelen(u08_t type) {
@@ -36,6 +38,10 @@ u08_t array_typelen(u08_t type) {
     return sizeof(nvm_short_t);
   if(type == T_INT)
     return sizeof(nvm_int_t);
+#ifdef NVM_USE_FLOAT
+  if(type == T_FLOAT)
+    return sizeof(nvm_float_t);
+#endif
 
   error(ERROR_ARRAY_ILLEGAL_TYPE);
   return 0;  // to make compiler happy
@@ -58,9 +64,70 @@ nvm_int_t array_length(heap_id_t id) {
 	 heap_get_len(id),
 	 array_typelen(*(u08_t*)heap_get_addr(id)));
 
-  return(heap_get_len(id)/
+  // the first byte of the chunk holds the type and is no element
+  return((heap_get_len(id)-1)/
 	 array_typelen(*(u08_t*)heap_get_addr(id)));
 }
+
+u08_t array_type(heap_id_t id) {
+  return *(u08_t*)heap_get_addr(id);
+}
+
+// the elements follow the type byte. The address is only valid
+// until the next heap allocation
+void *array_get_data(heap_id_t id) {
+  return (u08_t*)heap_get_addr(id) + 1;
+}
+
+// the bulk operations below work on whole elements, index and
+// length checks are up to the caller
+void array_copy(heap_id_t src, nvm_int_t srcpos,
+		heap_id_t dst, nvm_int_t dstpos, nvm_int_t length) {
+  u08_t len = array_typelen(array_type(src));
+  DEBUGF("arraycopy %x[%d] -> %x[%d], len = %d\n", 
+	 src, srcpos, dst, dstpos, length);
+
+  // src and dst may be the same array, so memmove
+  memmove((u08_t*)heap_get_addr(dst) + 1 + dstpos * len,
+	  (u08_t*)heap_get_addr(src) + 1 + srcpos * len, length * len);
+}
+
+void array_fill(heap_id_t id, nvm_int_t value) {
+  u08_t type = array_type(id);
+  nvm_int_t i, length = array_length(id);
+  DEBUGF("arrayfill %x = %d\n", id, value);
+
+  if(array_typelen(type) == sizeof(nvm_byte_t))
+    memset((u08_t*)heap_get_addr(id) + 1, value, length);
+  else {
+    nvm_int_t * ptr = (nvm_int_t *)((u08_t*)heap_get_addr(id) + 1);
+    for(i=0;i<length;i++)
+      *ptr++ = value;
+  }
+}
+
+bool_t array_equals(heap_id_t id1, heap_id_t id2) {
+  u16_t len = heap_get_len(id1);
+
+  // type byte and elements have to match
+  if(len != heap_get_len(id2))
+    return FALSE;
+
+  return memcmp(heap_get_addr(id1), heap_get_addr(id2), len) == 0;
+}
+
+heap_id_t array_copyof(heap_id_t id, nvm_int_t length) {
+  u08_t type = array_type(id);
+  nvm_int_t old = array_length(id);
+
+  // the caller has to keep id on the stack, the allocation may 
+  // garbage collect and move it
+  heap_id_t copy = array_new(length, type);
+  memset((u08_t*)heap_get_addr(copy) + 1, 0, length * array_typelen(type));
+  array_copy(id, 0, copy, 0, (length < old)?length:old);
+
+  return copy;
+}
  
 void array_bastore(heap_id_t id, nvm_int_t index, nvm_byte_t value) {
   nvm_byte_t * ptr = (nvm_byte_t *)heap_get_addr(id) + 1;
@@ -33,6 +33,13 @@
 
 heap_id_t   array_new(nvm_int_t length, u08_t type);
 nvm_int_t   array_length(heap_id_t id);
+u08_t       array_type(heap_id_t id);
+void        *array_get_data(heap_id_t id);
+void        array_copy(heap_id_t src, nvm_int_t srcpos, 
+		       heap_id_t dst, nvm_int_t dstpos, nvm_int_t length);
+void        array_fill(heap_id_t id, nvm_int_t value);
+bool_t      array_equals(heap_id_t id1, heap_id_t id2);
+heap_id_t   array_copyof(heap_id_t id, nvm_int_t length);
 void	    array_bastore(heap_id_t id, nvm_int_t index, nvm_byte_t value);
 nvm_byte_t  array_baload(heap_id_t id, nvm_int_t index);
 void        array_iastore(heap_id_t id, nvm_int_t index, nvm_int_t value);
@@ -34,6 +34,8 @@
 #include "vm.h"
 #include "native.h"
 #include "native_avr.h"
+#include "latency.h"
+#include "thread.h"
 #include "stack.h"
 #include "uart.h"
 
@@ -65,15 +67,61 @@ volatile u08_t *pins[]  = { NULL,   &PINB,  &PINC,  &PIND  };
 #endif
 
 volatile static nvm_int_t ticks;
+#if defined(NVM_USE_LATENCY) || defined(NVM_USE_THREADS)
+volatile static u32_t clock_ticks;   // like ticks, but never reset
+#endif
 
+// timer 1 runs in ctc mode, the hardware clears it on the match
 SIGNAL(SIG_OUTPUT_COMPARE1A) {
-  TCNT1 = 0;
   ticks++;
+#if defined(NVM_USE_LATENCY) || defined(NVM_USE_THREADS)
+  clock_ticks++;
+#endif
+}
+
+#ifdef NVM_USE_LATENCY
+#if defined(ATMEGA168)
+#define TIMER1_FLAGS TIFR1
+#else
+#define TIMER1_FLAGS TIFR
+#endif
+
+// time in timer 1 counts for the latency histograms. A match whose
+// interrupt is still pending has already cleared the counter
+u32_t latency_clock(void) {
+  u08_t sreg = SREG;
+  u32_t c, period;
+  u16_t cnt;
+
+  cli();
+  c = clock_ticks;
+  cnt = TCNT1;
+  period = OCR1A + 1;
+  if((TIMER1_FLAGS & _BV(OCF1A)) && (cnt < period/2))
+    c++;
+  SREG = sreg;
+
+  return c * period + cnt;
 }
+#endif
+
+#ifdef NVM_USE_THREADS
+// timer ticks for Thread.sleep()
+u32_t thread_clock(void) {
+  u08_t sreg = SREG;
+  u32_t t;
+
+  cli();
+  t = clock_ticks;
+  SREG = sreg;
+
+  return t;
+}
+#endif
 
 void native_init(void) {
   // init timer
-  TCCR1B = _BV(CS11);           // clk/8
+  TCCR1B = _BV(WGM12) | _BV(CS11);  // ctc mode, clk/8
   OCR1A = (u16_t)(CLOCK/800u);  // 100 Hz is default
 #if defined(ATMEGA168)
   TIMSK1 |= _BV(OCIE1A);         // interrupt on compare
@@ -126,9 +174,14 @@ void native_avr_timer_invoke(u08_t mref) {
   } else if(mref == NATIVE_METHOD_TWAIT) {
     nvm_int_t wait = stack_pop_int();
     ticks = 0;
+#ifdef NVM_USE_THREADS
+    thread_sleep(wait);       // the other threads run meanwhile
+#else
     while(ticks < wait);      // reset watchdog here if enabled
+#endif
   } else if(mref == NATIVE_METHOD_SETPRESCALER) {
-    TCCR1B = stack_pop_int();
+    // keep everything but prescaler
+    TCCR1B = (TCCR1B & ~7) | (stack_pop_int() & 7);
   } else
     error(ERROR_NATIVE_UNKNOWN_METHOD);
 }
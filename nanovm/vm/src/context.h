@@ -0,0 +1,128 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+
+//
+//  context.h
+//
+//  With NVM_USE_CONTEXT all state of a vm instance (heap, stack,
+//  locals, the nvm file and the caches that refer into it) lives
+//  in a context struct instead of globals. Every thread runs the
+//  vm of its own current context, so a unix process can run many
+//  independent vms in parallel. The modules keep using the names
+//  of their former globals, they are mapped onto the current
+//  context by macros in the module itself. Other modules reach
+//  them through accessors like VM_LOCALS in the module's header.
+//
+
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "types.h"
+#include "config.h"
+
+#ifdef NVM_USE_CONTEXT
+
+#ifndef UNIX
+#error "NVM_USE_CONTEXT is only supported by the unix version"
+#endif
+
+#include <setjmp.h>
+
+#include "vm.h"
+#include "heap.h"
+#include "nvmfile.h"
+#include "thread.h"
+
+#ifdef NVM_USE_FORMATTER
+#include "native_formatter.h"
+#endif
+
+typedef struct {
+  // heap.c
+  u08_t heap[HEAPSIZE];
+  u16_t heap_base;
+#ifdef NVM_USE_HEAP_STATS
+  heap_stats_t heap_stats;
+#endif
+
+  // stack.c
+  nvm_stack_t *stack;
+  nvm_stack_t *sp;
+  nvm_stack_t *stackbase;
+#ifdef NVM_USE_STACK_CHECK
+  nvm_stack_t *sp_saved;
+#endif
+
+  // vm.c
+  nvm_stack_t *locals;
+#ifdef NVM_USE_STATS
+  nvm_stats_t nvm_stats;
+#endif
+#ifdef NVM_USE_SLICE
+  vm_slice_t vm_slice;
+#endif
+
+  // thread.c
+#ifdef NVM_USE_THREADS
+  thread_table_t thread_table;
+#endif
+
+  // symbols.c, 0xffff before the first instruction
+#ifdef NVM_USE_SYMBOLS
+  u16_t symbols_mref;
+  u16_t symbols_pc;
+#endif
+
+  // nvmfile.c
+  u08_t *nvmfile;
+  u32_t nvmfile_len;         // length of the mapping, 0 for the default
+  u08_t nvmfile_constant_count;
+#ifdef NVM_USE_LIBRARY
+  // the library image itself is shared by all contexts
+  u08_t nvmlib_constant_count;
+  u08_t nvmlib_first_import;
+  u16_t nvmlib_import[NVMLIB_IMPORTS];
+#endif
+
+  // native_formatter.c
+#if defined(NVM_USE_FORMATTER) && (FORMATTER_CACHE_SIZE > 0)
+  nvm_ref_t format_cache_ref[FORMATTER_CACHE_SIZE];
+  formatDescr format_cache[FORMATTER_CACHE_SIZE];
+  u08_t format_cache_next;
+#endif
+
+  // a program embedding the vm (unix/libnanovm.c)
+  void *host;
+  jmp_buf *error_jmp;        // error() returns there instead of exiting
+  void (*host_native)(u16_t mref);  // natives of unknown classes
+  void (*host_output)(const u08_t *data, u16_t len);  // uart output
+} nvm_context_t;
+
+// the context the vm of the calling thread works on, threads
+// start with the one of the main thread
+extern __thread nvm_context_t *nvm_context;
+
+nvm_context_t *vm_context_new(void);
+void vm_context_free(nvm_context_t *ctx);
+void vm_context_set(nvm_context_t *ctx);
+
+#endif // NVM_USE_CONTEXT
+
+#endif // CONTEXT_H
@@ -39,13 +39,14 @@ void debug_enable(bool_t enable) {
 }
 
 void debugf(const char *fmt, ...) {
-  if(debug_enabled) {
-    va_list ap;
+  va_list ap;
 
-    va_start(ap, fmt);
-    vprintf(fmt, ap);
-    va_end(ap);
-  }
+  va_start(ap, fmt);
+  vprintf(fmt, ap);
+  va_end(ap);
+
+  // stdout is fully buffered, see uart.c
+  fflush(stdout);
 }
 #endif // UNIX
 
@@ -31,9 +31,19 @@
 #define DBG16 "%04x"
 #define DBG32 "%08x"
 
+// debug levels: 1 = vm, heap and loader messages,
+// 2 = additionally one message per executed instruction
+#ifndef DEBUG_LEVEL
+#define DEBUG_LEVEL 2
+#endif
+
 #ifdef DEBUG
-#define DEBUGF(...)  debugf(__VA_ARGS__)
-#define DEBUG_HEXDUMP(a,b) debug_hexdump(a,b)
+extern bool_t debug_enabled;
+
+// the enable check is done inline, so the arguments aren't
+// even evaluated while debug output is switched off
+#define DEBUGF(...)  do { if(debug_enabled) debugf(__VA_ARGS__); } while(0)
+#define DEBUG_HEXDUMP(a,b) do { if(debug_enabled) debug_hexdump(a,b); } while(0)
 void debugf(const char *fmt, ...);
 void debug_hexdump(void *data, u16_t size);
 #else
@@ -41,6 +51,12 @@ void debug_hexdump(void *data, u16_t size);
 #define DEBUG_HEXDUMP(a,b)
 #endif
 
+#if DEBUG_LEVEL >= 2
+#define DEBUGF_INSTR(...)  DEBUGF(__VA_ARGS__)
+#else
+#define DEBUGF_INSTR(...)
+#endif
+
 void debug_enable(bool_t enable);
 
 #endif //DEBUG_H
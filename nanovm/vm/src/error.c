@@ -32,6 +32,8 @@
 #include "config.h"
 #include "debug.h"
 #include "error.h"
+#include "symbols.h"
+#include "vm.h"
 
 #ifdef UNIX
 char *error_msg[] = {
@@ -45,12 +47,14 @@ char *error_msg[] = {
   "ARRAY: illegal type",             // G
   "NATIVE: unknown method",          // H
   "NATIVE: unknown class",           // I
-  "NVMFILE: unsupported features or not a valid nvm file",   // J
-  "NVMFILE: wrong nvm file version", // K
-  "VM: illegal reference",           // L
-  "VM: unsupported opcode",          // M
-  "VM: division by zero",            // N
-  "VM: stack corrupted",             // O
+  "NATIVE: illegal argument",        // J
+  "NVMFILE: unsupported features or not a valid nvm file",   // K
+  "NVMFILE: wrong nvm file version", // L
+  "NVMFILE: library missing or not matching", // M
+  "VM: illegal reference",           // N
+  "VM: unsupported opcode",          // O
+  "VM: division by zero",            // P
+  "VM: stack corrupted",             // Q
 };
 #else
 #include "uart.h"
@@ -58,7 +62,16 @@ char *error_msg[] = {
 
 void error(err_t code) {
 #ifdef UNIX
+#ifdef NVM_USE_CONTEXT
+  // a program embedding the vm handles the error itself
+  if(nvm_context->error_jmp)
+    longjmp(*nvm_context->error_jmp, 1+code);
+#endif
+
   printf("NanoVM error: %s\n", error_msg[code]);
+#ifdef NVM_USE_SYMBOLS
+  symbols_where();
+#endif
   exit(-1);
 #else
 
@@ -36,9 +36,15 @@
 #include "heap.h"
 #include "stack.h"
 #include "vm.h"
+#include "latency.h"
 
+#ifdef NVM_USE_CONTEXT
+#define heap      (nvm_context->heap)
+#define heap_base (nvm_context->heap_base)
+#else
 u08_t heap[HEAPSIZE];
 u16_t heap_base = 0;
+#endif
 
 #define HEAP_ID_FREE 0
 
@@ -134,6 +140,26 @@ void heap_show(void) {
   DEBUGF("- %d bytes stolen\n", heap_base);
 }
 
+#ifdef NVM_USE_HEAP_STATS
+#ifdef NVM_USE_CONTEXT
+#define heap_stats (nvm_context->heap_stats)
+#else
+heap_stats_t heap_stats;
+#endif
+
+// remember the highest heap usage, objects and stack together
+static void heap_stats_used(void) {
+  u16_t used = sizeof(heap) - sizeof(heap_t) - ((heap_t*)&heap[heap_base])->len;
+  if(used > heap_stats.used_peak)
+    heap_stats.used_peak = used;
+}
+#define HEAP_STATS_USED() heap_stats_used()
+#define HEAP_STATS(a)     a
+#else
+#define HEAP_STATS_USED()
+#define HEAP_STATS(a)
+#endif
+
 // search for chunk with id in heap and return chunk header
 // address
 heap_t *heap_search(heap_id_t id) {
@@ -172,6 +198,9 @@ bool_t heap_alloc_internal(heap_id_t id, bool_t fieldref, u16_t size) {
     h->id = id;
     h->fieldref = fieldref;
     h->len = size;
+    HEAP_STATS_USED();
+    HEAP_STATS(heap_stats.allocs++);
+    HEAP_STATS(heap_stats.alloc_bytes += size);
 #ifdef NVM_INITIALIZE_ALLOCATED
     // fill memory with zero
     u08_t * ptr = (void*)(h+1);
@@ -242,6 +271,7 @@ void heap_init(void) {
 
   // just one big free block
   heap_t *h = (heap_t*)&heap[0];
+  heap_base = 0;
   h->id  = HEAP_ID_FREE;
   h->len = sizeof(heap) - sizeof(heap_t);
 }
@@ -283,6 +313,10 @@ bool_t heap_fieldref(heap_id_t id) {
 void heap_garbage_collect(void) {
   u16_t current = heap_base;
   heap_t *h;
+#ifdef NVM_USE_HEAP_STATS
+  u16_t checks = 0;
+#endif
+  LATENCY_START(start);
   DEBUGF("heap_garbage_collect() free space before: %d\n", ((heap_t*)&heap[heap_base])->len);
   // set current to stack-top
   // walk through the entire heap
@@ -292,6 +326,7 @@ void heap_garbage_collect(void) {
 
     // found an entry
     if(h->id != HEAP_ID_FREE) {
+      HEAP_STATS(checks++);
       // check if it's still used
       if((!stack_heap_id_in_use(h->id))&&(!heap_fieldref(h->id))) {
 	// it is not used, remove it
@@ -300,6 +335,8 @@ void heap_garbage_collect(void) {
       
 	// move everything before to the top
 	heap_memcpy_up(heap+heap_base+len, heap+heap_base, current-heap_base);
+	HEAP_STATS(heap_stats.moved += current-heap_base);
+	HEAP_STATS(heap_stats.reclaimed++);
 
 	// add freed mem to free-chunk
 	h = (heap_t*)&heap[heap_base];
@@ -313,6 +350,16 @@ void heap_garbage_collect(void) {
     DEBUGF("heap_garbage_collect(): total size error\n");
     error(ERROR_HEAP_CORRUPTED);
   }
+
+#ifdef NVM_USE_HEAP_STATS
+  // the liveness checks scan stack and heap and are what makes
+  // a gc run take long, NVM_USE_LATENCY also times it
+  heap_stats.gc_runs++;
+  heap_stats.gc_checks += checks;
+  if(checks > heap_stats.gc_max)
+    heap_stats.gc_max = checks;
+#endif
+  LATENCY_END(LATENCY_GC, start);
   DEBUGF("heap_garbage_collect() free space after: %d\n", ((heap_t*)&heap[heap_base])->len);
 }
 
@@ -343,6 +390,11 @@ void heap_steal(u16_t bytes) {
   h = (heap_t*)&heap[heap_base];
   h->id = HEAP_ID_FREE;
   h->len = len - bytes;
+  HEAP_STATS_USED();
+#ifdef NVM_USE_HEAP_STATS
+  if(heap_base > heap_stats.stack_peak)
+    heap_stats.stack_peak = heap_base;
+#endif
 }
 
 // someone wants us to give some bytes back :-)
@@ -370,3 +422,23 @@ void heap_unsteal(u16_t bytes) {
   h->len = len + bytes;
 }
 
+#ifdef NVM_USE_HEAP_STATS
+// a single counter, the free memory is always one block at the
+// bottom since the garbage collector compacts the heap
+u32_t heap_stat(u08_t id) {
+  switch(id) {
+  case HEAP_STAT_SIZE:        return sizeof(heap);
+  case HEAP_STAT_FREE:        return ((heap_t*)&heap[heap_base])->len;
+  case HEAP_STAT_ALLOCS:      return heap_stats.allocs;
+  case HEAP_STAT_ALLOC_BYTES: return heap_stats.alloc_bytes;
+  case HEAP_STAT_GC_RUNS:     return heap_stats.gc_runs;
+  case HEAP_STAT_RECLAIMED:   return heap_stats.reclaimed;
+  case HEAP_STAT_MOVED:       return heap_stats.moved;
+  case HEAP_STAT_GC_CHECKS:   return heap_stats.gc_checks;
+  case HEAP_STAT_GC_MAX:      return heap_stats.gc_max;
+  case HEAP_STAT_STACK_PEAK:  return heap_stats.stack_peak;
+  case HEAP_STAT_USED_PEAK:   return heap_stats.used_peak;
+  }
+  return 0;
+}
+#endif
@@ -38,6 +38,44 @@ void      heap_garbage_collect(void);
 void      heap_steal(u16_t bytes);
 void      heap_unsteal(u16_t bytes);
 
+#ifdef NVM_USE_HEAP_STATS
+// counters read through heap_stat(), nanovm.lang.Runtime.stat() and
+// the NVMCOMM2 CMD_HSTAT query use the same numbers
+#define HEAP_STAT_SIZE        0   // total heap size
+#define HEAP_STAT_FREE        1   // free bytes, always a single block
+#define HEAP_STAT_ALLOCS      2   // objects allocated
+#define HEAP_STAT_ALLOC_BYTES 3   // bytes allocated for them
+#define HEAP_STAT_GC_RUNS     4   // garbage collections
+#define HEAP_STAT_RECLAIMED   5   // objects removed by the gc
+#define HEAP_STAT_MOVED       6   // bytes moved while compacting
+#define HEAP_STAT_GC_CHECKS   7   // object liveness checks of all gc runs
+#define HEAP_STAT_GC_MAX      8   // liveness checks of the longest gc run
+#define HEAP_STAT_STACK_PEAK  9   // most bytes stolen for the stack
+#define HEAP_STAT_USED_PEAK   10  // most bytes used by stack and objects
+#define HEAP_STAT_COUNT       11
+
+typedef struct {
+  u32_t allocs;
+  u32_t alloc_bytes;
+  u32_t reclaimed;
+  u32_t moved;
+  u32_t gc_checks;
+  u16_t gc_runs;
+  u16_t gc_max;
+  u16_t stack_peak;
+  u16_t used_peak;
+} heap_stats_t;
+
+#ifdef NVM_USE_CONTEXT
+#define HEAP_STATISTICS (nvm_context->heap_stats)
+#else
+extern heap_stats_t heap_stats;
+#define HEAP_STATISTICS heap_stats
+#endif
+
+u32_t     heap_stat(u08_t id);
+#endif
+
 #ifdef DEBUG_JVM
 void      heap_check(void);
 #define HEAP_CHECK()  heap_check()
@@ -0,0 +1,232 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+
+//
+//  latency.c
+//
+//  Log2 bucketed histograms of the time taken by garbage collector
+//  runs, native calls and up to LATENCY_METHODS selected methods,
+//  measured with a platform timer. Unlike averages they show the
+//  rare long stalls. A method is timed from its outermost call to
+//  the matching return, including everything it calls.
+//
+
+#include "types.h"
+#include "config.h"
+#include "debug.h"
+#include "error.h"
+
+#ifdef NVM_USE_LATENCY
+
+#if !defined(UNIX) && !defined(AVR) && !defined(STM32)
+#error "NVM_USE_LATENCY needs a timer, only unix, avr and stm32 have one"
+#endif
+
+#ifdef UNIX
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#endif
+
+#include "vm.h"
+#include "stack.h"
+#include "native.h"
+#include "latency.h"
+#include "symbols.h"
+
+#define NATIVE_METHOD_select   1
+#define NATIVE_METHOD_count    2
+#define NATIVE_METHOD_max      3
+#define NATIVE_METHOD_reset    4
+
+latency_hist_t latency_hist[LATENCY_HISTS];
+u08_t latency_selected = 0;   // one bit per slot in use
+bool_t latency_enabled = FALSE;  // time gc and native calls
+
+static u16_t latency_method[LATENCY_METHODS];
+static u16_t latency_active[LATENCY_METHODS];
+static u32_t latency_start[LATENCY_METHODS];
+
+#ifdef UNIX
+static char *latency_file;
+
+u32_t latency_clock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000ul + ts.tv_nsec / 1000;
+}
+#endif
+
+void latency_record(u08_t hist, u32_t start) {
+  latency_hist_t *h = &latency_hist[hist];
+  u32_t t = latency_clock() - start;
+  u32_t v = t;
+  u08_t b = 0;
+
+  // number of significant bits, 0 for no time at all
+  while(v && (b < LATENCY_BUCKETS-1))
+    v >>= 1, b++;
+
+  if(h->count[b] != 0xffff)
+    h->count[b]++;
+  if(t > h->max)
+    h->max = t;
+}
+
+// time mref in histogram LATENCY_METHOD+slot, LATENCY_NONE stops it
+void latency_select(u08_t slot, u16_t mref) {
+  latency_method[slot] = mref;
+  latency_active[slot] = 0;
+
+  if(mref == LATENCY_NONE) latency_selected &= ~(1<<slot);
+  else                     latency_selected |= 1<<slot;
+}
+
+void latency_reset(void) {
+  u08_t i, b;
+
+  for(i=0;i<LATENCY_HISTS;i++) {
+    for(b=0;b<LATENCY_BUCKETS;b++)
+      latency_hist[i].count[b] = 0;
+    latency_hist[i].max = 0;
+  }
+}
+
+void latency_call(u16_t mref) {
+  u08_t i;
+
+  // recursive calls are part of the outermost one
+  for(i=0;i<LATENCY_METHODS;i++)
+    if((latency_selected & (1<<i)) && (latency_method[i] == mref) &&
+       !latency_active[i]++)
+      latency_start[i] = latency_clock();
+}
+
+void latency_return(u16_t mref) {
+  u08_t i;
+
+  for(i=0;i<LATENCY_METHODS;i++)
+    if((latency_selected & (1<<i)) && (latency_method[i] == mref) &&
+       latency_active[i] && !--latency_active[i])
+      latency_record(LATENCY_METHOD+i, latency_start[i]);
+}
+
+// nanovm.lang.Latency
+void native_latency_invoke(u08_t mref) {
+  if(mref == NATIVE_METHOD_select) {
+    nvm_int_t method = stack_pop_int();
+    nvm_int_t slot = stack_pop_int();
+    if((slot < 0) || (slot >= LATENCY_METHODS))
+      error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+    latency_select(slot, (method < 0)?LATENCY_NONE:method);
+  } else if(mref == NATIVE_METHOD_count) {
+    nvm_int_t bucket = stack_pop_int();
+    nvm_int_t hist = stack_pop_int();
+    if((hist < 0) || (hist >= LATENCY_HISTS) ||
+       (bucket < 0) || (bucket >= LATENCY_BUCKETS))
+      error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+    stack_push(nvm_int2stack(latency_hist[hist].count[bucket]));
+  } else if(mref == NATIVE_METHOD_max) {
+    nvm_int_t hist = stack_pop_int();
+    u32_t max;
+    if((hist < 0) || (hist >= LATENCY_HISTS))
+      error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+    // saturate at the largest positive int
+    max = latency_hist[hist].max;
+    if(max > (u32_t)(NVM_IMMEDIATE_MASK>>1)-1)
+      max = (u32_t)(NVM_IMMEDIATE_MASK>>1)-1;
+    stack_push(nvm_int2stack(max));
+  } else if(mref == NATIVE_METHOD_reset) {
+    latency_reset();
+    latency_enabled = TRUE;
+  } else
+    error(ERROR_NATIVE_UNKNOWN_METHOD);
+}
+
+#ifdef UNIX
+static void latency_dump_hist(FILE *out, u08_t hist, char *name) {
+  latency_hist_t *h = &latency_hist[hist];
+  u32_t total = 0;
+  u08_t b;
+
+  for(b=0;b<LATENCY_BUCKETS;b++)
+    total += h->count[b];
+  if(!total)
+    return;
+
+  fprintf(out, "\n%s: %lu, max %lu us\n", name,
+	  (unsigned long)total, (unsigned long)h->max);
+
+  for(b=0;b<LATENCY_BUCKETS;b++) {
+    char range[24];
+
+    if(!h->count[b])
+      continue;
+    if(b < 2)
+      sprintf(range, "%u", b);
+    else if(b == LATENCY_BUCKETS-1)
+      sprintf(range, "%lu+", 1ul<<(b-1));
+    else
+      sprintf(range, "%lu-%lu", 1ul<<(b-1), (1ul<<b)-1);
+    fprintf(out, "  %12s us %u\n", range, h->count[b]);
+  }
+}
+
+static void latency_dump(void) {
+  char name[32];
+  FILE *out;
+  u08_t i;
+
+  if(!(out = fopen(latency_file, "w"))) {
+    perror(latency_file);
+    return;
+  }
+
+  fprintf(out, "latency histograms, log2 buckets\n");
+  latency_dump_hist(out, LATENCY_GC, "gc");
+  latency_dump_hist(out, LATENCY_NATIVE, "native calls");
+
+  for(i=0;i<LATENCY_METHODS;i++) {
+    char *method = NULL;
+
+    if(!(latency_selected & (1<<i)))
+      continue;
+#ifdef NVM_USE_SYMBOLS
+    method = symbols_method(latency_method[i]);
+#endif
+    if(!method) {
+      sprintf(name, "method %u", latency_method[i]);
+      method = name;
+    }
+    latency_dump_hist(out, LATENCY_METHOD+i, method);
+  }
+
+  fclose(out);
+}
+
+// -L: write the histograms to filename at exit
+void latency_enable(char *filename) {
+  latency_file = filename;
+  latency_enabled = TRUE;
+  atexit(latency_dump);
+}
+#endif // UNIX
+
+#endif // NVM_USE_LATENCY
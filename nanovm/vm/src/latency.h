@@ -0,0 +1,87 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+
+//
+//  latency.h
+//
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "types.h"
+#include "config.h"
+
+#ifdef NVM_USE_LATENCY
+
+#ifndef LATENCY_BUCKETS
+#define LATENCY_BUCKETS  16   // bucket b holds times from 2^(b-1) to 2^b-1
+#endif
+#ifndef LATENCY_METHODS
+#define LATENCY_METHODS  4    // methods that can be timed at once, max 8
+#endif
+
+// histograms, also the ids used by nanovm.lang.Latency
+#define LATENCY_GC       0    // garbage collector runs
+#define LATENCY_NATIVE   1    // native method calls
+#define LATENCY_METHOD   2    // first of the selected methods
+#define LATENCY_HISTS    (LATENCY_METHOD+LATENCY_METHODS)
+
+#define LATENCY_NONE     0xffff
+
+typedef struct {
+  u16_t count[LATENCY_BUCKETS];  // saturates at 0xffff
+  u32_t max;
+} latency_hist_t;
+
+extern latency_hist_t latency_hist[LATENCY_HISTS];
+extern u08_t latency_selected;
+extern bool_t latency_enabled;
+
+// platform timer: microseconds on unix and stm32, timer 1
+// counts (clk/8 unless changed by Timer.setPrescaler) on avr
+u32_t latency_clock(void);
+
+void latency_record(u08_t hist, u32_t start);
+void latency_select(u08_t slot, u16_t mref);
+void latency_reset(void);
+void latency_call(u16_t mref);
+void latency_return(u16_t mref);
+void native_latency_invoke(u08_t mref);
+
+#ifdef UNIX
+void latency_enable(char *filename);
+#endif
+
+// gc and native call timing costs a compare until -L or
+// Latency.reset() enables it, method timing as long as no method is
+// selected. t_on keeps a call enabled in between from being recorded
+#define LATENCY_START(t)   bool_t t##_on = latency_enabled; \
+                           u32_t t = t##_on?latency_clock():0
+#define LATENCY_END(h, t)  do { if(t##_on) latency_record(h, t); } while(0)
+#define LATENCY_CALL(m)    do { if(latency_selected) latency_call(m); } while(0)
+#define LATENCY_RETURN(m)  do { if(latency_selected) latency_return(m); } while(0)
+#else
+#define LATENCY_START(t)
+#define LATENCY_END(h, t)
+#define LATENCY_CALL(m)
+#define LATENCY_RETURN(m)
+#endif
+
+#endif // LATENCY_H
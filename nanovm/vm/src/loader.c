@@ -58,10 +58,7 @@ void loader_receive(void) {
   uart_write_byte(ASCII_NAK);
 
   // wait for data with timeout
-  for(sum=0;sum<250 && !uart_available();sum++)
-    delay(MILLISEC(4));
-
-  if(uart_available()) {
+  if(uart_wait(1000)) {
     nvmfile_write_initialize();
     do {
       // try to receive a full data block
@@ -98,6 +95,7 @@ void loader_receive(void) {
     } while((len < 1) || (loader.soh != ASCII_EOF));
     nvmfile_write_finalize();
     uart_write_byte(ASCII_ACK);
+    uart_flush();
 
 #ifdef ASURO
     // red status led
@@ -129,13 +127,12 @@ void loader_receive(void) {
 
 	// wait for 20ms communication pause
 	while (true) {
-		for (u08_t i=0; !uart_available() && (i<20); ++i) delay(MILLISEC(1));
-		if (uart_available()) uart_read_byte(); else break;
+		if (uart_wait(20) && !uart_eof()) uart_read_byte(); else break;
 	}
 
 	for (u08_t count = 0; g_nvm_runlevel != NVM_RUNLVL_VM; ++count) {
 		// wait for data with 100ms timeout
-		for (u08_t i=0; !uart_available() && (i<100); ++i) delay(MILLISEC(1));
+		uart_wait(100);
 
 		nvc2_check_input();
 
@@ -0,0 +1,255 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+
+//
+//  native_arraymath.c, numeric kernels over int and float arrays
+//
+
+#include "types.h"
+#include "debug.h"
+#include "config.h"
+#include "error.h"
+
+#if defined(NVM_USE_ARRAYMATH) && defined(NVM_USE_ARRAY)
+
+#include "vm.h"
+#include "stack.h"
+#include "array.h"
+#include "native.h"
+#include "native_arraymath.h"
+
+#define NATIVE_METHOD_sumI           1
+#define NATIVE_METHOD_sumF           2
+#define NATIVE_METHOD_dotI           3
+#define NATIVE_METHOD_dotF           4
+#define NATIVE_METHOD_scaleI         5
+#define NATIVE_METHOD_scaleF         6
+#define NATIVE_METHOD_minI           7
+#define NATIVE_METHOD_minF           8
+#define NATIVE_METHOD_maxI           9
+#define NATIVE_METHOD_maxF          10
+#define NATIVE_METHOD_movingAverageI 11
+#define NATIVE_METHOD_movingAverageF 12
+
+// The kernels work on the element data of the array chunks. On the
+// host the loops are kept simple enough for the compiler to vectorize
+// them, the float sums use four partial sums for that. The embedded
+// targets use plain sequential loops.
+
+// pop an array reference and make sure it's of the given type
+static heap_id_t native_arraymath_pop(u08_t type) {
+  heap_id_t id = stack_pop() & ~NVM_TYPE_MASK;
+  if(array_type(id) != type)
+    error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+  return id;
+}
+
+// pop two arrays of the same type and length, returns the length
+static nvm_int_t native_arraymath_pop2(u08_t type, 
+				       heap_id_t *id1, heap_id_t *id2) {
+  *id2 = native_arraymath_pop(type);
+  *id1 = native_arraymath_pop(type);
+  if(array_length(*id1) != array_length(*id2))
+    error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+  return array_length(*id1);
+}
+
+static nvm_int_t native_arraymath_dotI(nvm_int_t *a, nvm_int_t *b, 
+				       nvm_int_t len) {
+  nvm_int_t i, sum = 0;
+  for(i=0;i<len;i++)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+// min (less = TRUE) or max of a non-empty int array
+static nvm_int_t native_arraymath_extremeI(nvm_int_t *a, nvm_int_t len, 
+					   bool_t less) {
+  nvm_int_t i, val;
+
+  if(!len) error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+
+  val = a[0];
+  for(i=1;i<len;i++)
+    if(less?(a[i] < val):(a[i] > val))
+      val = a[i];
+
+  return val;
+}
+
+static void native_arraymath_averageI(nvm_int_t *src, nvm_int_t *dst, 
+				      nvm_int_t len, nvm_int_t window) {
+  nvm_int_t i;
+  s32_t sum = 0;
+
+  // running sum over the last window samples, shorter at the start
+  for(i=0;i<len;i++) {
+    sum += src[i];
+    if(i >= window) sum -= src[i-window];
+    dst[i] = sum / ((i < window)?(i+1):window);
+  }
+}
+
+#ifdef NVM_USE_FLOAT
+static nvm_float_t native_arraymath_sumF(nvm_float_t *a, nvm_int_t len) {
+  nvm_int_t i = 0;
+#ifdef UNIX
+  nvm_float_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  for(;i+4<=len;i+=4) {
+    s0 += a[i];
+    s1 += a[i+1];
+    s2 += a[i+2];
+    s3 += a[i+3];
+  }
+  nvm_float_t sum = (s0 + s1) + (s2 + s3);
+#else
+  nvm_float_t sum = 0;
+#endif
+  for(;i<len;i++)
+    sum += a[i];
+  return sum;
+}
+
+static nvm_float_t native_arraymath_dotF(nvm_float_t *a, nvm_float_t *b, 
+					 nvm_int_t len) {
+  nvm_int_t i = 0;
+#ifdef UNIX
+  nvm_float_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  for(;i+4<=len;i+=4) {
+    s0 += a[i]   * b[i];
+    s1 += a[i+1] * b[i+1];
+    s2 += a[i+2] * b[i+2];
+    s3 += a[i+3] * b[i+3];
+  }
+  nvm_float_t sum = (s0 + s1) + (s2 + s3);
+#else
+  nvm_float_t sum = 0;
+#endif
+  for(;i<len;i++)
+    sum += a[i] * b[i];
+  return sum;
+}
+
+static nvm_float_t native_arraymath_extremeF(nvm_float_t *a, nvm_int_t len, 
+					     bool_t less) {
+  nvm_int_t i;
+  nvm_float_t val;
+
+  if(!len) error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+
+  val = a[0];
+  for(i=1;i<len;i++)
+    if(less?(a[i] < val):(a[i] > val))
+      val = a[i];
+
+  return val;
+}
+
+static void native_arraymath_averageF(nvm_float_t *src, nvm_float_t *dst, 
+				      nvm_int_t len, nvm_int_t window) {
+  nvm_int_t i;
+  nvm_float_t sum = 0;
+
+  for(i=0;i<len;i++) {
+    sum += src[i];
+    if(i >= window) sum -= src[i-window];
+    dst[i] = sum / ((i < window)?(i+1):window);
+  }
+}
+#endif
+
+void native_arraymath_invoke(u08_t mref) {
+  heap_id_t id1, id2;
+  nvm_int_t i, len;
+
+  if(mref == NATIVE_METHOD_sumI) {
+    id1 = native_arraymath_pop(T_INT);
+    nvm_int_t *a = array_get_data(id1), sum = 0;
+    len = array_length(id1);
+    for(i=0;i<len;i++)
+      sum += a[i];
+    stack_push(nvm_int2stack(sum));
+
+  } else if(mref == NATIVE_METHOD_dotI) {
+    len = native_arraymath_pop2(T_INT, &id1, &id2);
+    stack_push(nvm_int2stack(native_arraymath_dotI(
+	array_get_data(id1), array_get_data(id2), len)));
+
+  } else if(mref == NATIVE_METHOD_scaleI) {
+    // a[i] = a[i] * mul / div
+    nvm_int_t div = stack_pop_int();
+    nvm_int_t mul = stack_pop_int();
+    id1 = native_arraymath_pop(T_INT);
+    nvm_int_t *a = array_get_data(id1);
+    if(!div) error(ERROR_VM_DIVISION_BY_ZERO);
+    len = array_length(id1);
+    for(i=0;i<len;i++)
+      a[i] = (s32_t)a[i] * mul / div;
+
+  } else if((mref == NATIVE_METHOD_minI) || (mref == NATIVE_METHOD_maxI)) {
+    id1 = native_arraymath_pop(T_INT);
+    stack_push(nvm_int2stack(native_arraymath_extremeI(
+	array_get_data(id1), array_length(id1), mref == NATIVE_METHOD_minI)));
+
+  } else if(mref == NATIVE_METHOD_movingAverageI) {
+    nvm_int_t window = stack_pop_int();
+    len = native_arraymath_pop2(T_INT, &id1, &id2);
+    if((window <= 0) || (id1 == id2)) 
+      error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+    native_arraymath_averageI(array_get_data(id1), array_get_data(id2), 
+			      len, window);
+
+#ifdef NVM_USE_FLOAT
+  } else if(mref == NATIVE_METHOD_sumF) {
+    id1 = native_arraymath_pop(T_FLOAT);
+    stack_push(nvm_float2stack(native_arraymath_sumF(
+	array_get_data(id1), array_length(id1))));
+
+  } else if(mref == NATIVE_METHOD_dotF) {
+    len = native_arraymath_pop2(T_FLOAT, &id1, &id2);
+    stack_push(nvm_float2stack(native_arraymath_dotF(
+	array_get_data(id1), array_get_data(id2), len)));
+
+  } else if(mref == NATIVE_METHOD_scaleF) {
+    nvm_float_t mul = stack_pop_float();
+    id1 = native_arraymath_pop(T_FLOAT);
+    nvm_float_t *a = array_get_data(id1);
+    len = array_length(id1);
+    for(i=0;i<len;i++)
+      a[i] *= mul;
+
+  } else if((mref == NATIVE_METHOD_minF) || (mref == NATIVE_METHOD_maxF)) {
+    id1 = native_arraymath_pop(T_FLOAT);
+    stack_push(nvm_float2stack(native_arraymath_extremeF(
+	array_get_data(id1), array_length(id1), mref == NATIVE_METHOD_minF)));
+
+  } else if(mref == NATIVE_METHOD_movingAverageF) {
+    nvm_int_t window = stack_pop_int();
+    len = native_arraymath_pop2(T_FLOAT, &id1, &id2);
+    if((window <= 0) || (id1 == id2)) 
+      error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+    native_arraymath_averageF(array_get_data(id1), array_get_data(id2), 
+			      len, window);
+#endif
+  } else
+    error(ERROR_NATIVE_UNKNOWN_METHOD);
+}
+
+#endif // NVM_USE_ARRAYMATH
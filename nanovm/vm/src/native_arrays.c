@@ -0,0 +1,108 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+
+//
+//  native_arrays.c, native array copy, fill and compare
+//
+
+#include "types.h"
+#include "debug.h"
+#include "config.h"
+#include "error.h"
+
+#ifdef NVM_USE_ARRAY
+
+#include "vm.h"
+#include "stack.h"
+#include "array.h"
+#include "native.h"
+#include "native_arrays.h"
+
+// java/lang/System
+#define NATIVE_METHOD_arraycopy 1
+
+// nanovm/util/Arrays
+#define NATIVE_METHOD_fillB     1
+#define NATIVE_METHOD_fillI     2
+#define NATIVE_METHOD_fillA     3
+#define NATIVE_METHOD_equalsB   4
+#define NATIVE_METHOD_equalsI   5
+#define NATIVE_METHOD_copyOfB   6
+#define NATIVE_METHOD_copyOfI   7
+#define NATIVE_METHOD_copyOfA   8
+
+
+// check that length elements starting at pos exist in the array
+static void native_array_check(heap_id_t id, nvm_int_t pos, nvm_int_t length) {
+  if((pos < 0) || (length < 0) || (pos + length > array_length(id)))
+    error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+}
+
+void native_java_lang_system_invoke(u08_t mref) {
+  if(mref == NATIVE_METHOD_arraycopy) {
+    nvm_int_t length = stack_pop_int();
+    nvm_int_t dstpos = stack_pop_int();
+    heap_id_t dst = stack_pop() & ~NVM_TYPE_MASK;
+    nvm_int_t srcpos = stack_pop_int();
+    heap_id_t src = stack_pop() & ~NVM_TYPE_MASK;
+
+    // object arrays are int arrays as well, copies between the
+    // two can't be told apart and aren't refused
+    if(array_type(src) != array_type(dst))
+      error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+
+    native_array_check(src, srcpos, length);
+    native_array_check(dst, dstpos, length);
+    array_copy(src, srcpos, dst, dstpos, length);
+  } else 
+    error(ERROR_NATIVE_UNKNOWN_METHOD);
+}
+
+void native_nanovm_util_arrays_invoke(u08_t mref) {
+  if((mref == NATIVE_METHOD_fillB) || (mref == NATIVE_METHOD_fillI)) {
+    nvm_int_t value = stack_pop_int();
+    array_fill(stack_pop() & ~NVM_TYPE_MASK, value);
+  } else if(mref == NATIVE_METHOD_fillA) {
+    // object arrays hold the references just like aastore does
+    nvm_int_t value = stack_pop();
+    array_fill(stack_pop() & ~NVM_TYPE_MASK, value);
+
+  } else if((mref == NATIVE_METHOD_equalsB) || 
+	    (mref == NATIVE_METHOD_equalsI)) {
+    heap_id_t id2 = stack_pop() & ~NVM_TYPE_MASK;
+    heap_id_t id1 = stack_pop() & ~NVM_TYPE_MASK;
+    stack_push(array_equals(id1, id2)?1:0);
+
+  } else if((mref == NATIVE_METHOD_copyOfB) || 
+	    (mref == NATIVE_METHOD_copyOfI) ||
+	    (mref == NATIVE_METHOD_copyOfA)) {
+    nvm_int_t length = stack_pop_int();
+    if(length < 0)
+      error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+
+    // leave the original on the stack while allocating the copy
+    heap_id_t copy = array_copyof(stack_peek(0) & ~NVM_TYPE_MASK, length);
+    stack_pop();
+    stack_push(copy | NVM_TYPE_HEAP);
+  } else 
+    error(ERROR_NATIVE_UNKNOWN_METHOD);
+}
+
+#endif
@@ -0,0 +1,158 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+
+//
+//  native_fixed.c, Q16.16 fixed point arithmetic
+//
+
+#include "types.h"
+#include "debug.h"
+#include "config.h"
+#include "error.h"
+
+#ifdef NVM_USE_FIXED
+
+#ifndef NVM_USE_32BIT_WORD
+#error "NVM_USE_FIXED requires NVM_USE_32BIT_WORD"
+#endif
+
+#include "vm.h"
+#include "stack.h"
+#include "native.h"
+#include "native_fixed.h"
+
+#ifdef AVR
+#include <avr/pgmspace.h>
+#define FIXED_SIN(i) ((u16_t)pgm_read_word(&native_fixed_sin[i]))
+#else
+#define PROGMEM
+#define FIXED_SIN(i) (native_fixed_sin[i])
+#endif
+
+#define NATIVE_METHOD_mul       1
+#define NATIVE_METHOD_div       2
+#define NATIVE_METHOD_sqrt      3
+#define NATIVE_METHOD_sin       4
+#define NATIVE_METHOD_cos       5
+#define NATIVE_METHOD_fromInt   6
+#define NATIVE_METHOD_toInt     7
+#define NATIVE_METHOD_fromFloat 8
+#define NATIVE_METHOD_toFloat   9
+
+#define FIXED_ONE      0x10000L
+
+// steps per full circle, in Q16.16 steps per radian (256/2pi)
+#define FIXED_STEPS_PER_RAD 2670177L
+
+// sin() of the first quadrant in 64 steps, scaled by 65536. The 
+// value at the end of the quadrant (65536) doesn't fit and is 
+// handled by native_fixed_quarter()
+static const u16_t native_fixed_sin[64] PROGMEM = {
+      0,  1608,  3216,  4821,  6424,  8022,  9616, 11204,
+  12785, 14359, 15924, 17479, 19024, 20557, 22078, 23586,
+  25080, 26558, 28020, 29466, 30893, 32303, 33692, 35062,
+  36410, 37736, 39040, 40320, 41576, 42806, 44011, 45190,
+  46341, 47464, 48559, 49624, 50660, 51665, 52639, 53581,
+  54491, 55368, 56212, 57022, 57798, 58538, 59244, 59914,
+  60547, 61145, 61705, 62228, 62714, 63162, 63572, 63944,
+  64277, 64571, 64827, 65043, 65220, 65358, 65457, 65516
+};
+
+static s32_t native_fixed_quarter(u08_t i) {
+  return (i < 64)?(s32_t)FIXED_SIN(i):FIXED_ONE;
+}
+
+// sine of a phase given in Q16.16 table steps (256 per circle),
+// linearly interpolated between the table entries
+static s32_t native_fixed_sin_steps(u32_t phase) {
+  u08_t index = phase >> 16;
+  u08_t i = index & 63;
+  s32_t a, b;
+
+  if(index & 64) {
+    // second and fourth quadrant run backwards
+    a = native_fixed_quarter(64-i);
+    b = native_fixed_quarter(63-i);
+  } else {
+    a = native_fixed_quarter(i);
+    b = native_fixed_quarter(i+1);
+  }
+
+  a += ((b - a) * (s32_t)(phase & 0xffff)) >> 16;
+  return (index & 128)?-a:a;
+}
+
+// square root of a Q16.16 value, bit by bit. Each step delivers one
+// result bit, 16 for the integer and 8 for the fraction part
+static s32_t native_fixed_sqrt(u32_t x) {
+  u32_t root = 0, rem_hi = 0, rem_lo = x, test;
+  u08_t count = 24;
+
+  while(count--) {
+    rem_hi = (rem_hi << 2) | (rem_lo >> 30);
+    rem_lo <<= 2;
+    root <<= 1;
+    test = (root << 1) + 1;
+    if(rem_hi >= test) {
+      rem_hi -= test;
+      root++;
+    }
+  }
+
+  return root;
+}
+
+void native_fixed_invoke(u08_t mref) {
+  if(mref == NATIVE_METHOD_mul) {
+    nvm_int_t b = stack_pop_int();
+    nvm_int_t a = stack_pop_int();
+    // round to nearest
+    stack_push(nvm_int2stack(((s64_t)a * b + 0x8000) >> 16));
+  } else if(mref == NATIVE_METHOD_div) {
+    nvm_int_t b = stack_pop_int();
+    nvm_int_t a = stack_pop_int();
+    if(!b) error(ERROR_VM_DIVISION_BY_ZERO);
+    stack_push(nvm_int2stack((s64_t)a * FIXED_ONE / b));
+  } else if(mref == NATIVE_METHOD_sqrt) {
+    nvm_int_t a = stack_pop_int();
+    if(a < 0) error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+    stack_push(nvm_int2stack(native_fixed_sqrt(a)));
+  } else if(mref == NATIVE_METHOD_sin) {
+    s64_t phase = (s64_t)stack_pop_int() * FIXED_STEPS_PER_RAD >> 16;
+    stack_push(nvm_int2stack(native_fixed_sin_steps(phase)));
+  } else if(mref == NATIVE_METHOD_cos) {
+    s64_t phase = (s64_t)stack_pop_int() * FIXED_STEPS_PER_RAD >> 16;
+    stack_push(nvm_int2stack(native_fixed_sin_steps(phase + (64L << 16))));
+  } else if(mref == NATIVE_METHOD_fromInt) {
+    stack_push(nvm_int2stack(stack_pop_int() * FIXED_ONE));
+  } else if(mref == NATIVE_METHOD_toInt) {
+    // rounds towards minus infinity like >> 16 in java
+    stack_push(nvm_int2stack(stack_pop_int() >> 16));
+#ifdef NVM_USE_FLOAT
+  } else if(mref == NATIVE_METHOD_fromFloat) {
+    stack_push(nvm_int2stack((nvm_int_t)(stack_pop_float() * FIXED_ONE)));
+  } else if(mref == NATIVE_METHOD_toFloat) {
+    stack_push(nvm_float2stack((nvm_float_t)stack_pop_int() / FIXED_ONE));
+#endif
+  } else
+    error(ERROR_NATIVE_UNKNOWN_METHOD);
+}
+
+#endif // NVM_USE_FIXED
@@ -28,10 +28,13 @@
 
 #ifdef NVM_USE_FORMATTER
 
+#include "vm.h"
 #include "stack.h"
 #include "native.h"
 #include "native_formatter.h"
 #include "nvmstring.h"
+#include "nvmfloat.h"
+#include "utils.h"
 
 #include <math.h>
 #include <stdio.h>
@@ -39,17 +42,25 @@
 #define NATIVE_METHOD_formatI 1
 #define NATIVE_METHOD_formatZ 2
 #define NATIVE_METHOD_formatF 3
-
-typedef struct 
-{
-  u08_t flags;
-  u08_t width;
-  u08_t prec;
-  u08_t conv;
-  u08_t pre_len;
-  u08_t post_len;
-  char * post;
-} formatDescr;
+#define NATIVE_METHOD_formatQ 4
+#define NATIVE_METHOD_appendI 5
+#define NATIVE_METHOD_appendZ 6
+#define NATIVE_METHOD_appendF 7
+#define NATIVE_METHOD_appendQ 8
+
+#if FORMATTER_CACHE_SIZE > 0
+#ifdef NVM_USE_CONTEXT
+// constant refs only identify a string within one nvm file,
+// so every vm context has a cache of its own
+#define format_cache_ref  (nvm_context->format_cache_ref)
+#define format_cache      (nvm_context->format_cache)
+#define format_cache_next (nvm_context->format_cache_next)
+#else
+static nvm_ref_t format_cache_ref[FORMATTER_CACHE_SIZE];
+static formatDescr format_cache[FORMATTER_CACHE_SIZE];
+static u08_t format_cache_next;
+#endif
+#endif
 
 // extracts all digits and fill remaining digits with '0'
 void inttostr(char * begin, char * end, u32_t val, u08_t base, char a)
@@ -133,143 +144,68 @@ int format_bool(char * res, formatDescr * fmtdscr, int val)
   }
 }
 
-#define FLOAT_DIGS 10
-
+#ifdef NVM_USE_FLOAT
 int format_float(char * res, formatDescr * fmtdscr, float val)
+{
+  // the flag bits are shared with nvmfloat
+  return nvmfloat_format(res, val, fmtdscr->conv, fmtdscr->prec,
+                         fmtdscr->flags);
+}
+#endif
+
+#ifdef NVM_USE_FIXED
+// Q16.16 resolves about 4.8 decimal digits, further digits are 0
+#define FIXED_DIGS 4
+
+int format_fixed(char * res, formatDescr * fmtdscr, s32_t val)
 {
   int n=0;
+  u32_t uval = val;
   if (val<0){
-    *res++='-', n++, val=-val;
+    *res++='-', n++, uval=-uval;
   } else if (fmtdscr->flags&0x04) {
     *res++='+', n++;
   } else if (fmtdscr->flags&0x08) {
     *res++=' ', n++;
   }
-  
-  char a = 'a';
-  char conv = fmtdscr->conv;
-  u08_t base = 10;
-  if (conv=='a'){
-    base=16;
-  }else if (conv=='A'){
-    base=16;
-    a='A';
-  }
-
-  s08_t max_prec = 8;
-  s08_t prec = max_prec;
-
-  float factA = 1.0;
-  for (u08_t i=0; i<prec-1; ++i){
-    factA*=(float)base;
-  }
-  float factB = base*factA;
-  
-  s08_t exp=0;
-
-  if (val>0.0) {
-    exp=prec-1;
-    while(val>=factB)
-      val/=base, exp+=1;
-    while(val<factA)
-      val*=base, exp-=1;
-  }
-  inttostr(res, res+prec, val, base, a);
 
-  while (prec>0){
-    if (res[prec-1]!='0')
-      break;
-    prec--;
-  }
-  //prec contains number of significant digits
-
-  // wenn exp>=0 exp+1 = Ziffern vor dem Komma
-  // wenn exp<0  |abs| = Nullen vor erster Ziffer
-  if ((exp<-4) || (exp>prec)) {
-    if (conv=='g') conv='e';
-    if (conv=='G') conv='E';
-  } else {
-    if (conv=='g') conv='f';
-    if (conv=='G') conv='f';
-  }
-  
-  s08_t pre=1;
-  if (conv=='f'){
-    if (exp>=0) {
-      pre += exp;
-    } else {
-      pre=0;
-    }
-  }
-  if (prec>pre)
-    prec -= pre;
-  else
-    prec=0;
-  
-  if (fmtdscr->prec != 255)
-    prec = fmtdscr->prec;
-  DEBUGF("formatting float prec=%i pre=%i exp=%i\n", (int)prec, (int)pre, (int)exp);
-
-  if (fmtdscr->flags&0x02){
-    if (prec==0)
-      prec=1;
-  }
-
-  u08_t offs = 1;
-  if (pre==0){
-    offs = -exp + 1;
-    prec += exp + 1;
-    if (prec<0) {
-      prec=0;
-    }
-  }
-  for (s08_t i=pre+prec; i>=pre; i--){
-    if (i>=max_prec)
-      res[i+offs]='0';
-    else
-      res[i+offs]=res[i];
-  }
-  
-  DEBUGF("formatting float prec=%i pre=%i exp=%i\n", (int)prec, (int)pre, (int)exp);
-  if (pre==0) {
-    *res++='0', n++;
-    if (prec>0){
-      *res++='.', n++;
-      while(++exp<0)
-        *res++='0', n++;
-    } else {
-      u08_t x = fmtdscr->prec;
-      if ((x != 255)&&(x!=0)) {
-        *res++='.', n++;
-        while(x--)
-          *res++='0', n++;
-      }
-    }
-  } else if (prec>0) {
-    res[pre]='.';
-    res++, n++;
-  } else {
+  u08_t prec = (fmtdscr->prec != 255)?fmtdscr->prec:FIXED_DIGS;
+  if (prec>30)
+    prec=30;    // keep within the result buffer
+  u08_t digs = (prec < FIXED_DIGS)?prec:FIXED_DIGS;
+  u32_t scale = 1;
+  for (u08_t i=0; i<digs; ++i)
+    scale*=10;
+
+  // round the fraction to digs digits, this may carry into the integer
+  u32_t ipart = uval>>16;
+  u32_t fpart = ((uval&0xffff)*scale + 0x8000)>>16;
+  if (fpart>=scale)
+    fpart-=scale, ipart++;
+
+  inttostr(res, res+10, ipart, 10, 'a');
+  u08_t pre = 10;
+  while ((pre>1) && (res[10-pre]=='0'))
+    pre--;
+  for (u08_t i=0; i<pre; ++i)
+    res[i]=res[10-pre+i];
+  res+=pre, n+=pre;
+
+  if (prec || (fmtdscr->flags&0x02)) {
+    *res++='.', n++;
+    inttostr(res, res+digs, fpart, 10, 'a');
+    res+=digs, n+=digs;
+    while (prec-- > digs)
+      *res++='0', n++;
   }
 
-  res+=pre+prec, n+=pre+prec;
-
-  if (conv!='f'){
-    *res++=conv, n++;
-    if (exp<0){
-      *res++='-', n++;
-      exp=-exp;
-    } else {
-      *res++='+', n++;
-    }
-    inttostr(res, res+2, exp, base, a);
-    n+=2;
-  }
-  
   return n;
 }
+#endif
 
 void make_format_descr(formatDescr * fmtdscr, char * fmt)
 {
+  char * start = fmt;
   u08_t mode=0;
   fmtdscr->flags = 0;
   fmtdscr->width = 0;
@@ -322,7 +258,7 @@ void make_format_descr(formatDescr * fmtdscr, char * fmt)
       case 4:
         mode=4;
         fmtdscr->conv=c;
-        fmtdscr->post=fmt;
+        fmtdscr->post=fmt-start;
         mode=5;
         break;
         
@@ -333,63 +269,119 @@ void make_format_descr(formatDescr * fmtdscr, char * fmt)
 }
 
 
+// constant format strings never change, so their parsed descriptor
+// is kept and looked up by the string reference
+formatDescr * get_format_descr(formatDescr * fmtdscr, nvm_ref_t ref)
+{
+#if FORMATTER_CACHE_SIZE > 0
+  if((ref & NVM_TYPE_MASK) == NVM_TYPE_CONST) {
+    u08_t i;
+    for(i=0; i<FORMATTER_CACHE_SIZE; i++)
+      if(format_cache_ref[i] == ref)
+        return &format_cache[i];
+
+    i = format_cache_next;
+    format_cache_next = (i+1) % FORMATTER_CACHE_SIZE;
+    make_format_descr(&format_cache[i], vm_get_addr(ref));
+    format_cache_ref[i] = ref;
+    return &format_cache[i];
+  }
+#endif
+
+  make_format_descr(fmtdscr, vm_get_addr(ref));
+  return fmtdscr;
+}
+
+// write the complete result, fmt may be ram or nvmfile memory
+void format_build(char * dst, char * fmt, formatDescr * fmtdscr,
+                  char * res, int len, u08_t add)
+{
+  native_strncpy(dst, fmt, fmtdscr->pre_len);
+  dst+=fmtdscr->pre_len;
+
+  if (!(fmtdscr->flags&0x01)){
+    while(add--)
+      *dst++=' ';
+  }
+
+  // res is a plain ram buffer, never part of the nvm file
+  utils_memcpy(dst, res, len);
+  dst+=len;
+
+  if (fmtdscr->flags&0x01){
+    while(add--)
+      *dst++=' ';
+  }
+  native_strncpy(dst, fmt+fmtdscr->post, fmtdscr->post_len);
+  dst+=fmtdscr->post_len;
+  *dst=0;
+}
+
+// forget the parsed format strings, the constant refs of a newly
+// loaded nvm file point to other strings
 void native_formatter_init(void) {
+#if FORMATTER_CACHE_SIZE > 0
+  u08_t i;
+
+  for(i=0; i<FORMATTER_CACHE_SIZE; i++)
+    format_cache_ref[i] = 0;
+  format_cache_next = 0;
+#endif
 }
 
 void native_formatter_invoke(u08_t mref) {
-  char * fmt = stack_peek_addr(0);
   char res[50];
   
-  formatDescr fmtdscr;
-  make_format_descr(&fmtdscr, fmt);
+  formatDescr descr;
+  formatDescr * fmtdscr = get_format_descr(&descr, stack_peek(0));
 
   int len = 0;
-  if(mref == NATIVE_METHOD_formatI) {
+  if((mref == NATIVE_METHOD_formatI) || (mref == NATIVE_METHOD_appendI)) {
     nvm_int_t val = stack_peek_int(1);
-    len = format_int(res, &fmtdscr, val);
-  } else if(mref == NATIVE_METHOD_formatZ) {
+    len = format_int(res, fmtdscr, val);
+  } else if((mref == NATIVE_METHOD_formatZ) || (mref == NATIVE_METHOD_appendZ)) {
     nvm_int_t val = stack_peek_int(1);
-    len = format_bool(res, &fmtdscr, val);
-  } else if(mref == NATIVE_METHOD_formatF) {
+    len = format_bool(res, fmtdscr, val);
+#ifdef NVM_USE_FLOAT
+  } else if((mref == NATIVE_METHOD_formatF) || (mref == NATIVE_METHOD_appendF)) {
     nvm_float_t val = stack_peek_float(1);
-    len = format_float(res, &fmtdscr, val);
+    len = format_float(res, fmtdscr, val);
+#endif
+#ifdef NVM_USE_FIXED
+  } else if((mref == NATIVE_METHOD_formatQ) || (mref == NATIVE_METHOD_appendQ)) {
+    nvm_int_t val = stack_peek_int(1);
+    len = format_fixed(res, fmtdscr, val);
+#endif
   } else
     error(ERROR_NATIVE_UNKNOWN_METHOD);
     
 
   u08_t add = 0;
-  if (fmtdscr.width>len)
-    add = (fmtdscr.width-len);
-    
-  // allocate heap and realign strings (address may be changed by gc...)
-  heap_id_t id = heap_alloc(FALSE, len + add + fmtdscr.pre_len + fmtdscr.post_len + 1);
-  int memoffset = (char*)stack_peek_addr(0)-(char*)fmt;
-  fmt+=memoffset;
-  fmtdscr.post+=memoffset;
-  char * dst = heap_get_addr(id);
-  
-  // build result string
-  native_strncpy(dst, fmt, fmtdscr.pre_len);
-  dst+=fmtdscr.pre_len;
-
-  if (!(fmtdscr.flags&0x01)){
-    while(add--)
-      *dst++=' ';
-  }
-
-  native_strncpy(dst, res, len);
-  dst+=len;
-  
-  if (fmtdscr.flags&0x01){
-    while(add--)
-      *dst++=' ';
+  if (fmtdscr->width>len)
+    add = (fmtdscr->width-len);
+  u16_t size = len + add + fmtdscr->pre_len + fmtdscr->post_len;
+
+  if(mref >= NATIVE_METHOD_appendI) {
+    // grow the string buffer and format directly behind its contents
+    heap_id_t id = stack_peek(2) & ~NVM_TYPE_MASK;
+    u16_t old = utils_strlen(heap_get_addr(id));
+    heap_realloc(id, old + size + 1);
+
+    // realloc may have moved a heap format string, so get it again
+    format_build((char*)heap_get_addr(id) + old, stack_peek_addr(0),
+                 fmtdscr, res, len, add);
+    stack_pop();
+    stack_pop();
+    // the buffer reference stays on the stack as result
+  } else {
+    // allocate heap and realign strings (address may be changed by gc...)
+    heap_id_t id = heap_alloc(FALSE, size + 1);
+    format_build(heap_get_addr(id), stack_peek_addr(0),
+                 fmtdscr, res, len, add);
+    stack_pop();
+    stack_pop();
+    stack_push(NVM_TYPE_HEAP | id);
   }
-  native_strncpy(dst, fmtdscr.post, fmtdscr.post_len);
-  dst+=fmtdscr.post_len;
-  *dst=0;
-  stack_pop();
-  stack_pop();
-  stack_push(NVM_TYPE_HEAP | id);
 }
 
 #endif //NVM_USE_MATH
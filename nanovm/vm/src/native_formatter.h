@@ -24,6 +24,22 @@
 #ifndef NATIVE_FORMATTER_H
 #define NATIVE_FORMATTER_H
 
+// number of parsed constant format strings to remember
+#ifndef FORMATTER_CACHE_SIZE
+#define FORMATTER_CACHE_SIZE 4
+#endif
+
+typedef struct 
+{
+  u08_t flags;
+  u08_t width;
+  u08_t prec;
+  u08_t conv;
+  u08_t pre_len;
+  u08_t post_len;
+  u08_t post;     // offset of the text behind the conversion
+} formatDescr;
+
 void native_formatter_init(void);
 void native_formatter_invoke(u08_t mref);
 
@@ -25,6 +25,21 @@
 #ifndef NATIVE_IMPL_H
 #define NATIVE_IMPL_H
 
+typedef void (*native_invoke_t)(u08_t mref);
+
+// the ports register the invoke function of each native class in
+// a table indexed by the class id, so dispatch is a single lookup
+#define NATIVE_DISPATCH(c, f)  [(c)-NATIVE_CLASS_BASE] = (f)
+
+#ifdef AVR
+#include <avr/pgmspace.h>
+#define NATIVE_DISPATCH_TABLE  const native_invoke_t native_dispatch[] PROGMEM
+#define NATIVE_DISPATCH_GET(c) ((native_invoke_t)pgm_read_word(&native_dispatch[c]))
+#else
+#define NATIVE_DISPATCH_TABLE  const native_invoke_t native_dispatch[]
+#define NATIVE_DISPATCH_GET(c) (native_dispatch[c])
+#endif
+
 void native_invoke(u16_t mref);
 void native_new(u16_t mref);
 void native_init(void);
@@ -66,69 +66,101 @@ void native_math_init(void) {
 }
 
 void native_math_invoke(u08_t mref) {
-  if(mref == NATIVE_METHOD_absF) {
+  // dense method ids, so the switch compiles to a jump table
+  switch(mref) {
+  case NATIVE_METHOD_absF:
     stack_push(nvm_float2stack(fabs(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_absI) {
+    break;
+  case NATIVE_METHOD_absI:
     stack_push(nvm_int2stack(abs(stack_pop_int())));
-  
-  } else if(mref == NATIVE_METHOD_acos) {
+    break;
+  case NATIVE_METHOD_acos:
     stack_push(nvm_float2stack(acos(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_asin) {
+    break;
+  case NATIVE_METHOD_asin:
     stack_push(nvm_float2stack(asin(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_atan) {
+    break;
+  case NATIVE_METHOD_atan:
     stack_push(nvm_float2stack(atan(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_atan2) {
+    break;
+  case NATIVE_METHOD_atan2: {
     nvm_float_t a = stack_pop_float();
     nvm_float_t b = stack_pop_float();
     stack_push(nvm_float2stack(atan2(a,b)));
-  } else if(mref == NATIVE_METHOD_ceil) {
+    break;
+  }
+  case NATIVE_METHOD_ceil:
     stack_push(nvm_float2stack(ceil(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_cos) {
+    break;
+  case NATIVE_METHOD_cos:
     stack_push(nvm_float2stack(cos(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_exp) {
+    break;
+  case NATIVE_METHOD_exp:
     stack_push(nvm_float2stack(exp(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_floor) {
+    break;
+  case NATIVE_METHOD_floor:
     stack_push(nvm_float2stack(floor(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_log) {
+    break;
+  case NATIVE_METHOD_log:
     stack_push(nvm_float2stack(log(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_maxF) {
-    nvm_float_t a=stack_pop_float();
-    nvm_float_t b=stack_pop_float();
+    break;
+  case NATIVE_METHOD_maxF: {
+    nvm_float_t a = stack_pop_float();
+    nvm_float_t b = stack_pop_float();
     stack_push(nvm_float2stack(a>b?a:b));
-  } else if(mref == NATIVE_METHOD_maxI) {
-    nvm_int_t a=stack_pop_int();
-    nvm_int_t b=stack_pop_int();
+    break;
+  }
+  case NATIVE_METHOD_maxI: {
+    nvm_int_t a = stack_pop_int();
+    nvm_int_t b = stack_pop_int();
     stack_push(nvm_int2stack(a>b?a:b));
-  } else if(mref == NATIVE_METHOD_minI) {
-    nvm_int_t a=stack_pop_int();
-    nvm_int_t b=stack_pop_int();
+    break;
+  }
+  case NATIVE_METHOD_minI: {
+    nvm_int_t a = stack_pop_int();
+    nvm_int_t b = stack_pop_int();
     stack_push(nvm_int2stack(a<b?a:b));
-  } else if(mref == NATIVE_METHOD_minF) {
-    nvm_float_t a=stack_pop_float();
-    nvm_float_t b=stack_pop_float();
+    break;
+  }
+  case NATIVE_METHOD_minF: {
+    nvm_float_t a = stack_pop_float();
+    nvm_float_t b = stack_pop_float();
     stack_push(nvm_float2stack(a<b?a:b));
-  } else if(mref == NATIVE_METHOD_pow) {
+    break;
+  }
+  case NATIVE_METHOD_pow: {
     nvm_float_t a = stack_pop_float();
     nvm_float_t b = stack_pop_float();
     stack_push(nvm_float2stack(pow(a,b)));
-  } else if(mref == NATIVE_METHOD_random) {
+    break;
+  }
+  case NATIVE_METHOD_random:
     stack_push(nvm_float2stack((nvm_float_t)rand()/RAND_MAX));
-  } else if(mref == NATIVE_METHOD_rint) {
+    break;
+  case NATIVE_METHOD_rint:
     stack_push(nvm_float2stack((int)(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_round) {
+    break;
+  case NATIVE_METHOD_round:
     stack_push(nvm_int2stack((int)(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_sin) {
+    break;
+  case NATIVE_METHOD_sin:
     stack_push(nvm_float2stack(sin(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_sqrt) {
+    break;
+  case NATIVE_METHOD_sqrt:
     stack_push(nvm_float2stack(sqrt(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_tan) {
+    break;
+  case NATIVE_METHOD_tan:
     stack_push(nvm_float2stack(tan(stack_pop_float())));
-  } else if(mref == NATIVE_METHOD_toDegrees) {
+    break;
+  case NATIVE_METHOD_toDegrees:
     stack_push(nvm_float2stack(180/M_PI*stack_pop_float()));
-  } else if(mref == NATIVE_METHOD_toRadians) {
+    break;
+  case NATIVE_METHOD_toRadians:
     stack_push(nvm_float2stack(M_PI/180*stack_pop_float()));
-  } else
+    break;
+  default:
     error(ERROR_NATIVE_UNKNOWN_METHOD);
+  }
 }
 
 #endif //NVM_USE_MATH
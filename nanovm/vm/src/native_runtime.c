@@ -0,0 +1,70 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+
+//
+//  native_runtime.c, heap usage and garbage collector counters
+//
+
+#include "types.h"
+#include "debug.h"
+#include "config.h"
+#include "error.h"
+
+#ifdef NVM_USE_HEAP_STATS
+
+#include "vm.h"
+#include "heap.h"
+#include "stack.h"
+#include "native.h"
+#include "native_runtime.h"
+
+#define NATIVE_METHOD_freeMemory   1
+#define NATIVE_METHOD_totalMemory  2
+#define NATIVE_METHOD_gcCount      3
+#define NATIVE_METHOD_gc           4
+#define NATIVE_METHOD_stat         5
+
+// largest positive int on the stack, 0x3fff or 0x3fffffff
+#define RUNTIME_INT_MAX ((u32_t)(NVM_IMMEDIATE_MASK>>1)-1)
+
+// counters may exceed the int range, saturate them
+static nvm_stack_t native_runtime_int(u32_t val) {
+  return nvm_int2stack((val > RUNTIME_INT_MAX)?RUNTIME_INT_MAX:val);
+}
+
+void native_runtime_invoke(u08_t mref) {
+  if(mref == NATIVE_METHOD_freeMemory) {
+    stack_push(native_runtime_int(heap_stat(HEAP_STAT_FREE)));
+  } else if(mref == NATIVE_METHOD_totalMemory) {
+    stack_push(native_runtime_int(heap_stat(HEAP_STAT_SIZE)));
+  } else if(mref == NATIVE_METHOD_gcCount) {
+    stack_push(native_runtime_int(heap_stat(HEAP_STAT_GC_RUNS)));
+  } else if(mref == NATIVE_METHOD_gc) {
+    heap_garbage_collect();
+  } else if(mref == NATIVE_METHOD_stat) {
+    nvm_int_t id = stack_pop_int();
+    if((id < 0) || (id >= HEAP_STAT_COUNT))
+      error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+    stack_push(native_runtime_int(heap_stat(id)));
+  } else
+    error(ERROR_NATIVE_UNKNOWN_METHOD);
+}
+
+#endif // NVM_USE_HEAP_STATS
@@ -35,6 +35,7 @@
 #include "native_stdio.h"
 #include "stack.h"
 #include "nvmstring.h"
+#include "nvmfloat.h"
 
 void native_itoa(char *str, nvm_int_t val) {
   nvm_int_t m;
@@ -66,38 +67,33 @@ void native_itoa(char *str, nvm_int_t val) {
 
 #ifdef NVM_USE_FLOAT
 void native_ftoa(char *str, nvm_float_t val) {
-  if (val<0)
-  {
-    *str++='-';
-    val=-val;
-  }
-
-  nvm_int_t i = val;
-  native_itoa(str, i);
-  while (*str) str++; // to string end
-  char * sep = str;
-  val+=1-i;
-  i=val*1000000;
-  native_itoa(str, i);
-  sep[0] ='.';
-  while (*str) str++; // to string end
-  while (*(--str)=='0') *str=0;
-  if (*str=='.') *str=0;
+  // like printf("%g") with as many digits as are needed to read the
+  // same float back, str needs room for 16 chars
+  str[nvmfloat_format(str, val, 'g', nvmfloat_shortest(val), 0)] = 0;
 }
 #endif
 
 // send a string to the console and append return if ret is true
 static void native_print(char *str, bool_t ret) {
-  u08_t chr;
+  char buf[NVMSTRING_CHUNK], *chunk;
+  u16_t len, i;
 
-  // check if source string is within internal nvm file, otherwise 
-  // it's directly being read from ram
-  if(NVMFILE_ISSET(str)) {
-    while((chr = nvmfile_read08(str++)))
-      uart_putc(chr);
-  } else
-    while(*str)
-      uart_putc(*str++);
+  // strings within the internal nvm file are read in chunks, strings
+  // in ram are written directly
+  while(str) {
+    chunk = native_strchunk(buf, &str, &len);
+
+    // write the pieces between newlines as blocks, uart_putc
+    // adds the carriage return
+    while(len) {
+      for(i=0;(i<len)&&(chunk[i]!='\n');i++);
+      uart_write_block((u08_t*)chunk, i);
+      if(i == len) break;
+
+      uart_putc('\n');
+      chunk += i+1; len -= i+1;
+    }
+  }
 
   if(ret)
     uart_putc('\n');
@@ -153,6 +149,16 @@ void native_java_io_inputstream_invoke(u08_t mref) {
     error(ERROR_NATIVE_UNKNOWN_METHOD);
 }    
 
+// invoke a native method within class nanovm/io/Console
+void native_nanovm_io_console_invoke(u08_t mref) {
+  if(mref == NATIVE_METHOD_WAITAVAILABLE) {
+    // sleep until input arrives or the timeout (in ms) expires
+    nvm_int_t ms = stack_pop_int();
+    stack_push(uart_wait((ms < 0)?0:(ms > 0xffff)?0xffff:ms));
+  } else 
+    error(ERROR_NATIVE_UNKNOWN_METHOD);
+}
+
 // invoke a native method within class java/lang/StringBuffer
 void native_java_lang_stringbuffer_invoke(u08_t mref) {
   if(mref == NATIVE_METHOD_INIT) {
@@ -183,7 +189,7 @@ void native_java_lang_stringbuffer_invoke(u08_t mref) {
             (mref == NATIVE_METHOD_APPEND_FLOAT)) {
     char *src0, *src1, *dst;
 #ifdef NVM_USE_FLOAT
-    char tmp[15];
+    char tmp[16];
 #else
 # ifdef NVM_USE_32BIT_WORD
     char tmp[10];
@@ -26,6 +26,7 @@
 
 void native_java_io_printstream_invoke(u08_t mref);
 void native_java_io_inputstream_invoke(u08_t mref);
+void native_nanovm_io_console_invoke(u08_t mref);
 void native_java_lang_stringbuffer_invoke(u08_t mref);
 void native_itoa(char *str, nvm_int_t val);
 
@@ -41,10 +41,30 @@
 #include "native_stdio.h"
 #endif
 
+#ifdef NVM_USE_ARRAY
+#include "native_arrays.h"
+#endif
+
 #ifdef NVM_USE_MATH
 #include "native_math.h"
 #endif
 
+#ifdef NVM_USE_ARRAYMATH
+#include "native_arraymath.h"
+#endif
+
+#ifdef NVM_USE_FIXED
+#include "native_fixed.h"
+#endif
+
+#ifdef NVM_USE_HEAP_STATS
+#include "native_runtime.h"
+#endif
+
+#ifdef NVM_USE_LATENCY
+#include "latency.h"
+#endif
+
 #ifdef NVM_USE_FORMATTER
 #include "native_formatter.h"
 #endif
@@ -78,66 +98,77 @@ void native_new(u16_t mref) {
     error(ERROR_NATIVE_UNKNOWN_CLASS);
 }
 
-void native_invoke(u16_t mref) {
-  // check for native classes/methods
-  if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_OBJECT) {
-    native_java_lang_object_invoke(NATIVE_ID2METHOD(mref));
+// invoke functions of the native classes, indexed by class id
+static NATIVE_DISPATCH_TABLE = {
+  NATIVE_DISPATCH(NATIVE_CLASS_OBJECT, native_java_lang_object_invoke),
 
 #ifdef NVM_USE_STDIO
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_PRINTSTREAM) {
-    native_java_io_printstream_invoke(NATIVE_ID2METHOD(mref));
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_INPUTSTREAM) {
-    native_java_io_inputstream_invoke(NATIVE_ID2METHOD(mref));
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_STRINGBUFFER) {
-    native_java_lang_stringbuffer_invoke(NATIVE_ID2METHOD(mref));
+  NATIVE_DISPATCH(NATIVE_CLASS_PRINTSTREAM, native_java_io_printstream_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_INPUTSTREAM, native_java_io_inputstream_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_CONSOLE, native_nanovm_io_console_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_STRINGBUFFER, native_java_lang_stringbuffer_invoke),
 #endif
 
-#ifdef NVM_USE_MATH
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_MATH) {
-    native_math_invoke(NATIVE_ID2METHOD(mref));
+#ifdef NVM_USE_ARRAY
+  // array copy, fill and compare
+  NATIVE_DISPATCH(NATIVE_CLASS_SYSTEM, native_java_lang_system_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_ARRAYS, native_nanovm_util_arrays_invoke),
 #endif
 
-#ifdef NVM_USE_FORMATTER
-    // the formatter class
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_FORMATTER) {
-    native_formatter_invoke(NATIVE_ID2METHOD(mref));
+#ifdef NVM_USE_MATH
+  NATIVE_DISPATCH(NATIVE_CLASS_MATH, native_math_invoke),
 #endif
 
-   // the Nibo specific classes
-
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_NIBO_BOT) {
-    native_nibo_bot_invoke(NATIVE_ID2METHOD(mref));
-
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_NIBO_CLOCK) {
-    native_nibo_clock_invoke(NATIVE_ID2METHOD(mref));
-
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_NIBO_GRAPHICDISPLAY) {
-    native_nibo_graphicdisplay_invoke(NATIVE_ID2METHOD(mref));
+#if defined(NVM_USE_ARRAYMATH) && defined(NVM_USE_ARRAY)
+  // the array math class
+  NATIVE_DISPATCH(NATIVE_CLASS_ARRAYMATH, native_arraymath_invoke),
+#endif
 
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_NIBO_DISTANCESENSOR) {
-    native_nibo_distsensor_invoke(NATIVE_ID2METHOD(mref));
+#ifdef NVM_USE_FIXED
+  // the fixed point class
+  NATIVE_DISPATCH(NATIVE_CLASS_FIXED, native_fixed_invoke),
+#endif
 
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_NIBO_EDGEDETECTOR) {
-    native_nibo_edgedetector_invoke(NATIVE_ID2METHOD(mref));
+#ifdef NVM_USE_HEAP_STATS
+  // heap usage and gc counters
+  NATIVE_DISPATCH(NATIVE_CLASS_RUNTIME, native_runtime_invoke),
+#endif
 
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_NIBO_IRTRANSCEIVER) {
-    native_nibo_irtransceiver_invoke(NATIVE_ID2METHOD(mref));
+#ifdef NVM_USE_LATENCY
+  // latency histograms
+  NATIVE_DISPATCH(NATIVE_CLASS_LATENCY, native_latency_invoke),
+#endif
 
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_NIBO_LEDS) {
-    native_nibo_leds_invoke(NATIVE_ID2METHOD(mref));
+#ifdef NVM_USE_FORMATTER
+  // the formatter class
+  NATIVE_DISPATCH(NATIVE_CLASS_FORMATTER, native_formatter_invoke),
+#endif
 
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_NIBO_LINEDETECTOR) {
-    native_nibo_linedetector_invoke(NATIVE_ID2METHOD(mref));
+  // the Nibo specific classes
+  NATIVE_DISPATCH(NATIVE_CLASS_NIBO_BOT, native_nibo_bot_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_NIBO_CLOCK, native_nibo_clock_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_NIBO_GRAPHICDISPLAY, native_nibo_graphicdisplay_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_NIBO_DISTANCESENSOR, native_nibo_distsensor_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_NIBO_EDGEDETECTOR, native_nibo_edgedetector_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_NIBO_IRTRANSCEIVER, native_nibo_irtransceiver_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_NIBO_LEDS, native_nibo_leds_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_NIBO_LINEDETECTOR, native_nibo_linedetector_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_NIBO_MOTOR, native_nibo_motor_invoke),
+  NATIVE_DISPATCH(NATIVE_CLASS_NIBO_WHEELENCODER, native_nibo_wheelencoder_invoke),
+};
 
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_NIBO_MOTOR) {
-    native_nibo_motor_invoke(NATIVE_ID2METHOD(mref));
+void native_invoke(u16_t mref) {
+  u08_t cls = NATIVE_ID2CLASS(mref) - NATIVE_CLASS_BASE;
+  native_invoke_t func = 0;
 
-  } else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_NIBO_WHEELENCODER) {
-    native_nibo_wheelencoder_invoke(NATIVE_ID2METHOD(mref));
+  // a single table lookup instead of comparing all class ids
+  if(cls < sizeof(native_dispatch)/sizeof(native_invoke_t))
+    func = NATIVE_DISPATCH_GET(cls);
 
-  } else {
+  if(func)
+    func(NATIVE_ID2METHOD(mref));
+  else
     error(ERROR_NATIVE_UNKNOWN_CLASS);
-  }
 }
 
 void native_init(void)
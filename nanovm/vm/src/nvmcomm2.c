@@ -25,6 +25,10 @@
 #include "loader.h"
 #include "nvmfile.h"
 
+#ifdef NVM_USE_HEAP_STATS
+#include "heap.h"
+#endif
+
 
 #ifdef NVMCOMM2
 
@@ -116,6 +120,7 @@ size8_t g_nvc2_dsize = 0;
 
 s08_t g_nvc2_file_open = -1;
 u16_t g_nvc2_file_pos = 0;
+u08_t g_nvc2_seq_next = 0;
 
 bool g_nvc2_query_success = false;
 u08_t g_nvc2_query_rsize = 0;
@@ -249,8 +254,9 @@ bool nvc2_proc_input(u08_t value) {
 			}
 			// stop tracking
 			nvc2_message_unset_tracking();
-			// update last-message id
-			g_nvc2_lastid = g_nvc2_msgid;
+			// update last-message id, the retransmission of a corrupted
+			// message must not be taken for a repeated one
+			if (!nvc2_message_invalid()) g_nvc2_lastid = g_nvc2_msgid;
 		} else if (g_nvc2_track == 4) {
 			// CMD
 			if (!nvc2_message_ignore()) {
@@ -294,6 +300,21 @@ static inline void nvc2_send_response() {
 
 	uart_write_byte((u08_t)(crc & 0xFF));
 	uart_write_byte((u08_t)(crc >> 8));
+	uart_flush();
+}
+
+
+// CRC-16 of a file block of NVC2_CRC_BLOCK_SIZE bytes, lets the host
+// skip uploading blocks the target already has
+static u16_t nvc2_file_block_crc(u16_t block) {
+	u08_t *addr = nvmfile_get_base();
+	addr += (u32_t)block * NVC2_CRC_BLOCK_SIZE;
+	u16_t crc = 0xFFFF;
+
+	for (size8_t i=0; i<NVC2_CRC_BLOCK_SIZE; ++i)
+		crc = crc16_ccitt_lsbf_update(nvmfile_read08(addr++), crc);
+
+	return crc;
 }
 
 
@@ -336,6 +357,47 @@ static inline void nvc2_process_query() {
 						g_nvc2_query_success = true;
 					}					
 				} break;
+				case NVC2_CMD_FCRC: {
+					// CRCs of respSize/2 consecutive blocks, starting
+					// at the block number given as parameter
+					if ( (g_nvc2_file_open == NVC2_FILE_FIRMWARE)
+						 && (nvc2_query_dsize() == 3) && !(respSize & 1) ) {
+						u16_t block = data[1] | (data[2] << 8);
+						
+						if ((u32_t)(block + respSize/2) * NVC2_CRC_BLOCK_SIZE <= CODESIZE) {
+							for (size8_t i=0; i<respSize; i+=2) {
+								u16_t crc = nvc2_file_block_crc(block++);
+								data[i] = (u08_t)(crc & 0xFF);
+								data[i+1] = (u08_t)(crc >> 8);
+							}
+
+							g_nvc2_query_rsize = respSize;
+							g_nvc2_query_success = true;
+						}
+					}
+				} break;
+#ifdef NVM_USE_HEAP_STATS
+				case NVC2_CMD_HSTAT: {
+					// respSize/4 heap counters, starting at the counter
+					// given as parameter, 32 bit each, low byte first
+					if ((nvc2_query_dsize() == 2) && !(respSize & 3)) {
+						u08_t id = data[1];
+						
+						if (id + respSize/4 <= HEAP_STAT_COUNT) {
+							for (size8_t i=0; i<respSize; i+=4) {
+								u32_t val = heap_stat(id++);
+								data[i] = (u08_t)val;
+								data[i+1] = (u08_t)(val >> 8);
+								data[i+2] = (u08_t)(val >> 16);
+								data[i+3] = (u08_t)(val >> 24);
+							}
+
+							g_nvc2_query_rsize = respSize;
+							g_nvc2_query_success = true;
+						}
+					}
+				} break;
+#endif
 				case NVC2_CMD_RUNLVL: {
 					if (respSize==1) {
 						data[0] = g_nvm_runlevel;
@@ -354,8 +416,9 @@ static inline void nvc2_process_query() {
 			switch (command) {
 				case NVC2_CMD_FOPEN: {
 					if ((dsize==1) && (data0 <= NVC2_MAX_FID)) {
-						g_nvc2_file_open = data[1];
+						g_nvc2_file_open = data0;
 						g_nvc2_file_pos = 0;
+						g_nvc2_seq_next = (g_nvc2_msgid + 1) & 0x07;
 						g_nvc2_query_success = true;
 					}
 				} break;
@@ -378,6 +441,42 @@ static inline void nvc2_process_query() {
 						g_nvc2_query_success = true;
 					}
 				} break;
+				case NVC2_CMD_WRSEQ: {
+					// pipelined write, the host may send several blocks
+					// without waiting for a response. Blocks are numbered
+					// by their message id, starting after the last
+					// FOPEN/FSEEK. Blocks out of sequence are dropped, the
+					// cumulative acknowledge makes the host go back to the
+					// first missing one.
+					if (g_nvc2_file_open == NVC2_FILE_FIRMWARE) {
+						if (g_nvc2_msgid == g_nvc2_seq_next) {
+							g_nvm_runlevel = NVM_RUNLVL_CONF;
+
+							u08_t *addr = nvmfile_get_base();
+							addr += g_nvc2_file_pos;
+
+							for (size8_t i=0; i<dsize; ++i) {
+								nvmfile_write08(addr++, data[i]);
+								++g_nvc2_file_pos;
+							}
+							g_nvc2_seq_next = (g_nvc2_seq_next + 1) & 0x07;
+						}
+
+						// id of the last block written in sequence
+						data[0] = (g_nvc2_seq_next - 1) & 0x07;
+						g_nvc2_query_rsize = 1;
+						g_nvc2_query_success = true;
+					}
+				} break;
+				case NVC2_CMD_FSEEK: {
+					u16_t pos = data0 | (data[1] << 8);
+					if ( (g_nvc2_file_open == NVC2_FILE_FIRMWARE)
+						 && (dsize==2) && (pos <= CODESIZE) ) {
+						g_nvc2_file_pos = pos;
+						g_nvc2_seq_next = (g_nvc2_msgid + 1) & 0x07;
+						g_nvc2_query_success = true;
+					}
+				} break;
 				case NVC2_CMD_RUNLVL: {
 //if (((1<<data0) & ((1<<NVM_RUNLVL_HALT)|(1<<NVM_RUNLVL_CONF)|(1<<NVM_RUNLVL_VM)|(1<<NVM_RUNLVL_RESET))) > 0)
 					if ( (dsize==1) && ( (data0==NVM_RUNLVL_HALT)
@@ -407,11 +506,8 @@ static inline void nvc2_process_query() {
 
 void nvc2_check_input() {
 	while (true) {
-		// wait for input within timeout limits
-		for (u08_t i=0; !uart_available() && (i < NVC2_RECV_UART_TIMEOUT); ++i)
-			{ delay(MILLISEC(1)); }
-		
-		if (uart_available()) {
+		// wait for input within timeout limits, end of file is no input
+		if (uart_wait(NVC2_RECV_UART_TIMEOUT) && !uart_eof()) {
 			// input available
 			u08_t value = uart_read_byte();
 			if (!nvc2_enabled() || !nvc2_proc_input(value)) {
@@ -433,4 +529,45 @@ void nvc2_check_input() {
 }
 
 
+// service the link between two slices of a running program. Input
+// that doesn't belong to a message is given back in its order, the
+// program reads it through System.in or Console. Up to
+// NVC2_POLL_SKIP such bytes are looked past for the start of a
+// message. At end of file there's nothing to wait for.
+void nvc2_poll() {
+	u08_t skipped[NVC2_POLL_SKIP];
+	size8_t nskipped = 0;
+
+	if (!nvc2_enabled()) return;
+
+	while (true) {
+		if (nvc2_message_tracking()) {
+			// rest of the message, wait for it like nvc2_check_input()
+			if (!uart_wait(NVC2_RECV_UART_TIMEOUT) || uart_eof()) {
+				nvc2_message_drop();
+				break;
+			}
+		} else if (!uart_available() || uart_eof() ||
+			   (nskipped == NVC2_POLL_SKIP))
+			break;
+
+		u08_t value = uart_read_byte();
+		if (!nvc2_proc_input(value)) {
+			// no message start, keep it for the program
+			skipped[nskipped++] = value;
+			continue;
+		}
+
+		if (nvc2_query_available()) {
+			// query received
+			nvc2_process_query();
+			break;
+		}
+	}
+
+	// unread puts in front, so start with the last byte
+	while (nskipped)
+		uart_unread_byte(skipped[--nskipped]);
+}
+
 #endif // NVMCOMM2
@@ -115,12 +115,19 @@ static inline uint16_t crc16_ccitt_lsbf_update(uint8_t data, uint16_t crc) {
 
 #define NVC2_BUFFER_SIZE 16      // NVC2 I/O data buffer size
 
+#define NVC2_CRC_BLOCK_SIZE 32   // file block size used by NVC2_CMD_FCRC
+#define NVC2_POLL_SKIP 8         // input bytes nvc2_poll() looks past for a message
+
 #define NVC2_MAX_FID 0           // maximum supported file id
 #define NVC2_FILE_FIRMWARE 0x00  // firmware file id
 
 #define NVC2_CMD_FOPEN   0x70
 #define NVC2_CMD_FCLOSE  0x71
 #define NVC2_CMD_RWFILE  0x72
+#define NVC2_CMD_FCRC    0x73
+#define NVC2_CMD_FSEEK   0x74
+#define NVC2_CMD_WRSEQ   0x75
+#define NVC2_CMD_HSTAT   0x76
 #define NVC2_CMD_RUNLVL  0x7E
 
 #define NVC2_STATUS_ENABLED   (1<<7)  // 1/0: NVM-Comm2 enabled/disabled
@@ -152,13 +159,15 @@ extern u08_t g_nvc2_command;       // Used only if (g_nvc2_msg_status & NVC2_QUE
 
 // For write queries, g_nvc2_data contains the write data,
 // g_nvc2_dsize is set to the data length.
-// For read queries, g_nvc2_data[0] is set to RSP, g_nvc2_dsize is not set.
+// For read queries, g_nvc2_data[0] is set to RSP, g_nvc2_data[1..] contains
+// optional query parameters, g_nvc2_dsize is set to their length plus one.
 // On reception of invalid or repeated messages, g_nvc2_data is not modified.
 extern u08_t g_nvc2_data[NVC2_BUFFER_SIZE];
 extern size8_t g_nvc2_dsize;
 
 extern s08_t g_nvc2_file_open;     // open file id (id 0 = firmware);
 extern u16_t g_nvc2_file_pos;      // read/write position in open file
+extern u08_t g_nvc2_seq_next;      // message id of next expected CMD_WRSEQ block
 
 extern bool g_nvc2_query_success;  // success of last query
 extern u08_t g_nvc2_query_rsize;   // last response length
@@ -220,6 +229,8 @@ bool nvc2_proc_input(u08_t value);
 
 void nvc2_check_input();
 
+void nvc2_poll();
+
 
 #endif // NVMCOMM2
 
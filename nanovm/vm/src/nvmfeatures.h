@@ -29,6 +29,26 @@
 # endif
 #endif
 
+// the run time statistics report the heap counters
+#ifdef NVM_USE_STATS
+# ifndef NVM_USE_HEAP_STATS
+#  define NVM_USE_HEAP_STATS
+# endif
+#endif
+
+#ifdef NVM_USE_RAW_FLOAT
+# ifndef NVM_USE_FLOAT
+#  error "NVM_USE_RAW_FLOAT requires NVM_USE_FLOAT!"
+# endif
+#endif
+
+// a thread's run() is found like a virtual method
+#ifdef NVM_USE_THREADS
+# ifndef NVM_USE_INHERITANCE
+#  error "NVM_USE_THREADS requires NVM_USE_INHERITANCE!"
+# endif
+#endif
+
 
 #define NVMFILE_VERSION    2
 #define NVMFILE_MAGIC      0xBE000000L
@@ -41,6 +61,8 @@
 #define NVM_FEAUTURE_ARRAY        (1L<<4)
 #define NVM_FEAUTURE_INHERITANCE  (1L<<5)
 #define NVM_FEAUTURE_EXTSTACK     (1L<<6)
+#define NVM_FEAUTURE_LIBRARY      (1L<<7)
+#define NVM_FEAUTURE_RAWFLOAT     (1L<<8)
 
 #ifndef NVM_USE_LOOKUPSWITCH
 # undef NVM_FEAUTURE_LOOKUPSWITCH
@@ -77,6 +99,16 @@
 # define NVM_FEAUTURE_EXTSTACK 0
 #endif
 
+#ifndef NVM_USE_LIBRARY
+# undef NVM_FEAUTURE_LIBRARY
+# define NVM_FEAUTURE_LIBRARY 0
+#endif
+
+#ifndef NVM_USE_RAW_FLOAT
+# undef NVM_FEAUTURE_RAWFLOAT
+# define NVM_FEAUTURE_RAWFLOAT 0
+#endif
+
 
 #define NVM_MAGIC_FEAUTURE (NVMFILE_MAGIC\
                            |NVM_FEAUTURE_LOOKUPSWITCH\
@@ -84,7 +116,26 @@
                            |NVM_FEAUTURE_32BIT\
                            |NVM_FEAUTURE_FLOAT\
                            |NVM_FEAUTURE_ARRAY\
-                           |NVM_FEAUTURE_INHERITANCE)
+                           |NVM_FEAUTURE_INHERITANCE\
+                           |NVM_FEAUTURE_LIBRARY\
+                           |NVM_FEAUTURE_RAWFLOAT)
+
+// here rather than in nvmfile.h since context.h sizes the import
+// table with it and may be reached from nvmfile.h before its end
+#ifdef NVM_USE_LIBRARY
+// the classes and methods of the resident library are numbered
+// behind the ones of the application, its strings carry a flag
+#define NVMLIB_CLASS_BASE   8
+#define NVMLIB_METHOD_BASE  0x800
+#define NVMLIB_STRING_FLAG  0x2000
+
+#define NVMLIB_IS_METHOD(m) ((m) >= NVMLIB_METHOD_BASE)
+
+// maximum number of library methods an application may import
+#ifndef NVMLIB_IMPORTS
+#define NVMLIB_IMPORTS 32
+#endif
+#endif
 
 
 #endif // _NVMFEAUTURES_H_
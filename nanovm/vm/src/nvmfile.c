@@ -33,6 +33,8 @@
 #include "vm.h"
 #include "eeprom.h"
 #include "nvmfeatures.h"
+#include "native.h"
+#include "native_formatter.h"
 
 #ifdef NVM_USE_FLASH_PROGRAM
 # include <avr/io.h>
@@ -43,40 +45,79 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// preferred location of the mapped nvm file. The vm passes nvm file
+// addresses around as ptr_t with NVMFILE_FLAG set, so the mapping
+// must be addressable by a ptr_t and must not itself touch the flag bit
+#ifndef NVMFILE_MAP_ADDR
+#define NVMFILE_MAP_ADDR 0x10000000
+#endif
 
+#ifndef NVMLIB_MAP_ADDR
+#define NVMLIB_MAP_ADDR  0x18000000
+#endif
 
-void nvmfile_load(char *filename, bool_t quiet) {
-  FILE *file;
-  u16_t size;
-  u08_t *buffer;
+// with NVM_USE_CONTEXT every vm maps its own file, the following
+// ones are placed behind the first
+#define NVMFILE_MAP_STEP  0x10000
+#define NVMFILE_MAP_TRIES 256
 
-  file = fopen(filename, "rb");
-  if(!file) {
-    printf("Unable to open file %s\n", filename);
-    exit(-1);
+// the offsets in the header of an nvm file are 16 bit wide, a
+// larger file can't be addressed
+#define NVMFILE_MAX_SIZE  0x10000
+
+// reserve a zero filled read only area of len bytes at addr
+static u08_t *nvmfile_reserve_at(ptr_t addr, u32_t len) {
+  u08_t *base;
+
+  base = mmap((void*)addr, len, PROT_READ,
+	      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(base == MAP_FAILED)
+    return NULL;
+
+  if(((u08_t*)(ptr_t)base != base) ||
+     NVMFILE_ISSET(base) || NVMFILE_ISSET(base + len - 1)) {
+    munmap(base, len);
+    return NULL;
   }
 
-  // get file size
-  fseek(file, 0l, SEEK_END);
-  size = ftell(file);
-  fseek(file, 0l, SEEK_SET);
+  return base;
+}
 
-  buffer = malloc(size);
+static u08_t *nvmfile_reserve(ptr_t addr, u32_t len) {
+  u08_t *base = nvmfile_reserve_at(addr, len);
+#ifdef NVM_USE_CONTEXT
+  ptr_t step = (len + NVMFILE_MAP_STEP - 1) & ~(NVMFILE_MAP_STEP - 1);
+  u16_t i;
 
-  if(!quiet)
-    printf("Loading %s, size %d\n", filename, size);
+  for(i=1;!base && (i<NVMFILE_MAP_TRIES);i++)
+    base = nvmfile_reserve_at(addr + i*step, len);
+#endif
 
-  if(fread(buffer, 1l, size, file) != size) {
-    perror("fread()");
-    exit(-1);
-  }
+  return base;
+}
+
+static u08_t *nvmfile_map(int fd, u32_t size, ptr_t addr, u32_t len) {
+  u08_t *base;
 
-  DEBUG_HEXDUMP(buffer, size);
+  // reserve a zero filled area large enough for the file or the
+  // requested size, so uploads via the loader still find room
+  if(!(base = nvmfile_reserve(addr, len)))
+    return NULL;
 
-  // store in uvm buffer
-  nvmfile_store(0, buffer, size);
+  // map the file itself read only on top of the reservation. It is
+  // private, so writes via nvmfile_store() never reach the disk
+  if(mmap(base, size, PROT_READ,
+	  MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+    munmap(base, len);
+    return NULL;
+  }
 
-  fclose(file);
+  return base;
 }
 #endif // UNIX
 
@@ -92,17 +133,225 @@ static u08_t nvmfile[CODESIZE] PROGMEM =
 #ifdef STM32
 static eeprom_addr_t nvmfile = 0x0000;	// Offset from EEPROM_START_ADDRESS
 #else
+#ifdef UNIX
+// the pre-installed default is used unless a file is loaded, which
+// then replaces the whole buffer
+#ifdef NVM_USE_CONTEXT
+u08_t nvmfile_default[CODESIZE] =
+#include "nvmdefault.h"
+#define nvmfile     (nvm_context->nvmfile)
+#define nvmfile_len (nvm_context->nvmfile_len)
+#else
+static u08_t nvmfile_default[CODESIZE] =
+#include "nvmdefault.h"
+static u08_t *nvmfile = nvmfile_default;
+static u32_t nvmfile_len = 0;  // length of the mapping, 0 for the default
+#endif
+#else
 static u08_t EEPROM nvmfile[CODESIZE] =
 #include "nvmdefault.h"
+#endif //UNIX
 #endif //STM32
 #endif
 
+#ifdef NVM_USE_LIBRARY
+// the resident library image, it is linked against the
+// application by nvmfile_init()
+#ifdef UNIX
+static u08_t *nvmlib = NULL;
+static u32_t nvmlib_len = 0;
+#define NVMLIB_SIZE nvmlib_len
+#else
+// nvmlibrary.h is written by NanoVMTool -b -c (see LIBRARY in
+// vm/src/Makefile), the array takes the size of the image
+#ifdef NVM_USE_FLASH_PROGRAM
+#ifdef STM32
+#else
+static u08_t nvmlib[] PROGMEM =
+#include "nvmlibrary.h"
+#endif //STM32
+#else
+#ifdef STM32
+static eeprom_addr_t nvmlib = CODESIZE;	// library follows the application
+#else
+static u08_t EEPROM nvmlib[] =
+#include "nvmlibrary.h"
+#endif //STM32
+#endif
+#ifdef STM32
+#define NVMLIB_SIZE CODESIZE
+#else
+#define NVMLIB_SIZE sizeof(nvmlib)
+#endif
+#endif //UNIX
+
+#ifdef NVM_USE_CONTEXT
+#define nvmlib_constant_count (nvm_context->nvmlib_constant_count)
+#define nvmlib_first_import   (nvm_context->nvmlib_first_import)
+#define nvmlib_import         (nvm_context->nvmlib_import)
+#else
+static u08_t nvmlib_constant_count;
+
+// the import table of the application is resolved into
+// this table of library method references
+static u08_t nvmlib_first_import;
+static u16_t nvmlib_import[NVMLIB_IMPORTS];
+#endif
+
+static u16_t nvmfile_get_method_by_fixed_class_and_id(u08_t class, u08_t id);
+#endif
+
+#ifdef NVM_USE_CONTEXT
+#define nvmfile_constant_count (nvm_context->nvmfile_constant_count)
+#else
 u08_t nvmfile_constant_count;
+#endif
+
+// space available for the application, a mapped file may be larger
+#ifdef UNIX
+#define NVMFILE_SIZE (nvmfile_len?nvmfile_len:CODESIZE)
+#else
+#define NVMFILE_SIZE CODESIZE
+#endif
+
+#ifdef UNIX
+static u08_t *nvmfile_load_file(char *filename, bool_t quiet, 
+				ptr_t addr, u32_t reserve, u32_t *len) {
+  struct stat st;
+  u32_t size;
+  u08_t *base;
+  int fd;
+
+  fd = open(filename, O_RDONLY);
+  if(fd < 0) {
+    printf("Unable to open file %s\n", filename);
+    exit(-1);
+  }
+
+  // get file size
+  if(fstat(fd, &st) < 0) {
+    perror("fstat()");
+    exit(-1);
+  }
+  size = st.st_size;
+
+  if(!quiet)
+    printf("Loading %s, size %u\n", filename, size);
+
+  if(!size) {
+    printf("File %s is empty\n", filename);
+    exit(-1);
+  }
+
+  if(size > NVMFILE_MAX_SIZE) {
+    printf("File %s is too large (%u > %u bytes)\n", 
+	   filename, size, NVMFILE_MAX_SIZE);
+    exit(-1);
+  }
+
+  // map file instead of copying it into a buffer
+  *len = (size > reserve)?size:reserve;
+  base = nvmfile_map(fd, size, addr, *len);
+  if(!base) {
+    printf("Unable to map file %s\n", filename);
+    exit(-1);
+  }
+
+  // the mapping stays valid after the descriptor is closed
+  close(fd);
+
+  DEBUG_HEXDUMP(base, (size > 0xffff)?0xffff:size);
+
+  return base;
+}
+
+void nvmfile_load(char *filename, bool_t quiet) {
+  u32_t len;
+
+#ifdef NVM_USE_CONTEXT
+  nvmfile_unload();
+#endif
+
+  // keep at least CODESIZE bytes, so the loader may still upload
+  nvmfile = nvmfile_load_file(filename, quiet, NVMFILE_MAP_ADDR, CODESIZE, &len);
+  nvmfile_len = len;
+}
+
+#ifdef NVM_USE_CONTEXT
+// use a copy of an image in memory, e.g. one handed over by a
+// program embedding the vm
+bool_t nvmfile_load_image(const u08_t *image, u32_t size) {
+  u32_t len = (size > CODESIZE)?size:CODESIZE;
+  u08_t *base;
+
+  nvmfile_unload();
+
+  if(size > NVMFILE_MAX_SIZE)
+    return FALSE;
+
+  if(!(base = nvmfile_reserve(NVMFILE_MAP_ADDR, len)))
+    return FALSE;
+
+  nvmfile = base;
+  nvmfile_len = len;
+  nvmfile_store(0, (u08_t*)image, size);
+
+  return TRUE;
+}
+
+// drop the file of the current context, it falls back to the default
+void nvmfile_unload(void) {
+  if(nvmfile_len)
+    munmap(nvmfile, nvmfile_len);
+
+  nvmfile = nvmfile_default;
+  nvmfile_len = 0;
+}
+#endif
+
+#ifdef NVM_USE_LIBRARY
+void nvmlib_load(char *filename, bool_t quiet) {
+  nvmlib = nvmfile_load_file(filename, quiet, NVMLIB_MAP_ADDR, 0, &nvmlib_len);
+}
+#endif
+
+// the mapping is read only, a write opens up the pages it
+// touches for the time being
+static void nvmfile_protect(u32_t index, u32_t size, int prot) {
+  unsigned long page = sysconf(_SC_PAGESIZE);
+  unsigned long start = (unsigned long)(nvmfile + index) & ~(page - 1);
+  unsigned long end = (unsigned long)(nvmfile + index + size);
+
+  // the pre-installed default is an ordinary array
+  if(!nvmfile_len || !size)
+    return;
+
+  if(mprotect((void*)start, end - start, prot) < 0) {
+    perror("mprotect()");
+    exit(-1);
+  }
+}
+#endif // UNIX
 
 void *nvmfile_get_base(void) {
   return (void *)nvmfile;
 }
 
+// number of bytes from addr up to the end of the image it lies in
+u32_t nvmfile_get_avail(void *addr) {
+  u08_t *ptr = (u08_t*)NVMFILE_ADDR(addr);
+
+#ifdef NVM_USE_LIBRARY
+  if((ptr >= (u08_t*)nvmlib) && (ptr < (u08_t*)nvmlib + NVMLIB_SIZE))
+    return (u08_t*)nvmlib + NVMLIB_SIZE - ptr;
+#endif
+
+  if((ptr >= (u08_t*)nvmfile) && (ptr < (u08_t*)nvmfile + NVMFILE_SIZE))
+    return (u08_t*)nvmfile + NVMFILE_SIZE - ptr;
+
+  return 0;
+}
+
 #ifdef NVM_USE_FLASH_PROGRAM
 
 void nvmfile_read(void *dst, void *src, u16_t len) {
@@ -173,13 +422,17 @@ u32_t nvmfile_read32(void *addr) {
 
 void nvmfile_write08(void *addr, u08_t data) {
   addr = NVMFILE_ADDR(addr);  // remove marker (if present)
+#ifdef UNIX
+  nvmfile_store((u08_t*)addr - nvmfile, &data, 1);
+#else
   eeprom_write_byte((eeprom_addr_t)addr, data);
+#endif
 }
 
 #endif // NVM_USE_FLASH_PROGRAM
 
-bool_t nvmfile_init(void) {
-  u32_t features = nvmfile_read32(&((nvm_header_t*)nvmfile)->magic_feature);
+static bool_t nvmfile_check(u08_t *image) {
+  u32_t features = nvmfile_read32(&((nvm_header_t*)image)->magic_feature);
   DEBUGF("NVM_MAGIC_FEAUTURE[file] = %x\n", features);
   DEBUGF("NVM_MAGIC_FEAUTURE[vm] = %x\n", NVM_MAGIC_FEAUTURE);
 
@@ -188,38 +441,159 @@ bool_t nvmfile_init(void) {
     return FALSE;
   }
 
-  if(nvmfile_read08(&((nvm_header_t*)nvmfile)->version) != NVMFILE_VERSION) {
+#ifdef NVM_USE_RAW_FLOAT
+  // float constants of files without raw floats use the squeezed encoding
+  if((features & NVM_FEAUTURE_FLOAT) && !(features & NVM_FEAUTURE_RAWFLOAT)) {
+    error(ERROR_NVMFILE_MAGIC);
+    return FALSE;
+  }
+#endif
+
+  if(nvmfile_read08(&((nvm_header_t*)image)->version) != NVMFILE_VERSION) {
     error(ERROR_NVMFILE_VERSION);
     return FALSE;
   }
 
-  u16_t t = nvmfile_read16(&((nvm_header_t*)nvmfile)->string_offset);
-  t      -= nvmfile_read16(&((nvm_header_t*)nvmfile)->constant_offset);
-  nvmfile_constant_count = t/4;
+  return TRUE;
+}
+
+static u08_t nvmfile_get_constant_count(u08_t *image) {
+  u16_t t = nvmfile_read16(&((nvm_header_t*)image)->string_offset);
+  t      -= nvmfile_read16(&((nvm_header_t*)image)->constant_offset);
+  return t/4;
+}
+
+#ifdef NVM_USE_LIBRARY
+// resolve the import table at the end of the application methods
+// against the methods of the resident library
+static bool_t nvmlib_link(void) {
+  u08_t i, methods = nvmfile_read08(&((nvm_header_t*)nvmfile)->methods);
+  nvm_method_hdr_t mhdr;
+
+  for(nvmlib_first_import = methods; nvmlib_first_import > 0;
+      nvmlib_first_import--) {
+    nvmfile_read(&mhdr, nvmfile_get_method_hdr(nvmlib_first_import-1),
+		 sizeof(nvm_method_hdr_t));
+    if(!(mhdr.flags & FLAG_IMPORT))
+      break;
+  }
+
+  // nothing imported, the library is not used at all
+  if(nvmlib_first_import == methods)
+    return TRUE;
+
+#ifdef UNIX
+  if(!nvmlib) {
+    error(ERROR_NVMFILE_LIBRARY);
+    return FALSE;
+  }
+#endif
+
+  if(!nvmfile_check((u08_t*)nvmlib))
+    return FALSE;
+
+  if(methods - nvmlib_first_import > NVMLIB_IMPORTS) {
+    error(ERROR_NVMFILE_LIBRARY);
+    return FALSE;
+  }
+
+  nvmlib_constant_count = nvmfile_get_constant_count((u08_t*)nvmlib);
+
+  for(i=nvmlib_first_import;i<methods;i++) {
+    u16_t mref;
+
+    nvmfile_read(&mhdr, nvmfile_get_method_hdr(i), sizeof(nvm_method_hdr_t));
+
+    // imports carry the id of the library they were linked against
+    if(mhdr.code_index != 
+       nvmfile_read16(&((nvm_header_t*)nvmlib)->main)) {
+      error(ERROR_NVMFILE_LIBRARY);
+      return FALSE;
+    }
+
+    mref = nvmfile_get_method_by_fixed_class_and_id(
+		 mhdr.id >> 8, mhdr.id & 0xff);
+
+    if(mref == 0xffff) {
+      error(ERROR_NVMFILE_LIBRARY);
+      return FALSE;
+    }
+
+    DEBUGF("import %d -> library method %d\n", i, 
+	   mref - NVMLIB_METHOD_BASE);
+    nvmlib_import[i - nvmlib_first_import] = mref;
+  }
+
+  return TRUE;
+}
+
+// map the index of an imported method to the library method
+u16_t nvmfile_resolve(u16_t index) {
+  if((index >= nvmlib_first_import) && !NVMLIB_IS_METHOD(index))
+    return nvmlib_import[index - nvmlib_first_import];
+
+  return index;
+}
+
+static bool_t nvmlib_linked(void) {
+  return nvmlib_first_import < 
+    nvmfile_read08(&((nvm_header_t*)nvmfile)->methods);
+}
+#endif
+
+bool_t nvmfile_init(void) {
+  if(!nvmfile_check((u08_t*)nvmfile))
+    return FALSE;
+
+#ifdef NVM_USE_FORMATTER
+  native_formatter_init();
+#endif
+
+  nvmfile_constant_count = nvmfile_get_constant_count((u08_t*)nvmfile);
+
+#ifdef NVM_USE_LIBRARY
+  if(!nvmlib_link())
+    return FALSE;
+#endif
 
   return TRUE;
 }
 
-void nvmfile_store(u16_t index, u08_t *buffer, u16_t size) {
+void nvmfile_store(u16_t index, u08_t *buffer, u32_t size) {
 #ifdef DEBUG
   // this check is not required in real life, since the code
   // limit is verified by the upload tool and by the compiler for
   // the default code
-  if(size > CODESIZE) {
+  if(index + size > NVMFILE_SIZE) {
     DEBUGF("Code size exceeds buffer size (%d > %d)\n",
-	   size, CODESIZE);
+	   index + size, NVMFILE_SIZE);
     for(;;);
   }
 #endif
 
+#ifdef UNIX
+  nvmfile_protect(index, size, PROT_READ | PROT_WRITE);
+  eeprom_write_block(buffer, (eeprom_addr_t)(nvmfile + index), size);
+  nvmfile_protect(index, size, PROT_READ);
+#else
   eeprom_write_block(buffer, (eeprom_addr_t)(nvmfile + index), size);
+#endif
 }
 
 nvm_method_hdr_t *nvmfile_get_method_hdr(u16_t index) {
+  u08_t *image = (u08_t*)nvmfile;
+
+#ifdef NVM_USE_LIBRARY
+  if(NVMLIB_IS_METHOD(index)) {
+    image = (u08_t*)nvmlib;
+    index -= NVMLIB_METHOD_BASE;
+  }
+#endif
+
   // get pointer to method header
   nvm_method_hdr_t *hdrs =
-    ((nvm_method_hdr_t*)(nvmfile +
-	 nvmfile_read16(&((nvm_header_t*)nvmfile)->method_offset)))+index;
+    ((nvm_method_hdr_t*)(image +
+	 nvmfile_read16(&((nvm_header_t*)image)->method_offset)))+index;
 
   return(hdrs);
 }
@@ -239,9 +613,41 @@ u32_t nvmfile_get_constant(u08_t index) {
   return res;
 }
 
-void nvmfile_call_main(void) {
+#ifdef NVM_USE_LIBRARY
+// same as above for constants used by library methods
+u32_t nvmlib_get_constant(u08_t index) {
+  if (index<nvmlib_constant_count)
+  {
+    u16_t addr = nvmfile_read16(&((nvm_header_t*)nvmlib)->constant_offset);
+    u32_t result = nvmfile_read32(nvmlib+addr+4*index);
+    DEBUGF("  library constant = 0x%08x\n", result);
+    return result;
+  }
+
+  DEBUGF("  library constant string index = %i\n", index);
+  nvm_ref_t res = NVM_TYPE_CONST | NVMLIB_STRING_FLAG | 
+    (index-nvmlib_constant_count);
+  return res;
+}
+#endif
+
+// run the static initializers of library and application
+static void nvmfile_call_clinit(void) {
   u08_t i;
 
+#ifdef NVM_USE_LIBRARY
+  // the library classes are initialized first
+  if(nvmlib_linked()) {
+    for(i=0;i<nvmfile_read08(&((nvm_header_t*)nvmlib)->methods);i++) {
+      if(nvmfile_read08(&nvmfile_get_method_hdr(NVMLIB_METHOD_BASE+i)->flags)
+	 & FLAG_CLINIT) {
+	DEBUGF("calling library clinit %d\n", i);
+	vm_run(NVMLIB_METHOD_BASE+i);
+      }
+    }
+  }
+#endif
+
   for(i=0;i<nvmfile_read08(&((nvm_header_t*)nvmfile)->methods);i++) {
     // is this a clinit method?
     if(nvmfile_read08(&nvmfile_get_method_hdr(i)->flags) & FLAG_CLINIT) {
@@ -249,64 +655,106 @@ void nvmfile_call_main(void) {
       vm_run(i);
     }
   }
+}
+
+void nvmfile_call_main(void) {
+  nvmfile_call_clinit();
 
   // determine method description address and code
   vm_run(nvmfile_read16(&((nvm_header_t*)nvmfile)->main));
 }
 
+#ifdef NVM_USE_SLICE
+// like nvmfile_call_main(), main() is then run by vm_run_slice()
+void nvmfile_start_main(void) {
+  nvmfile_call_clinit();
+  vm_start(nvmfile_read16(&((nvm_header_t*)nvmfile)->main));
+}
+#endif
+
 void *nvmfile_get_addr(u16_t ref) {
+  u08_t *image = (u08_t*)nvmfile;
+
+#ifdef NVM_USE_LIBRARY
+  if(ref & NVMLIB_STRING_FLAG) {
+    image = (u08_t*)nvmlib;
+    ref &= ~NVMLIB_STRING_FLAG;
+  }
+#endif
+
   // get pointer to string
   u16_t *refs =
-    (u16_t*)(nvmfile +
-	     nvmfile_read16(&((nvm_header_t*)nvmfile)->string_offset));
+    (u16_t*)(image +
+	     nvmfile_read16(&((nvm_header_t*)image)->string_offset));
 
   return((u08_t*)refs + nvmfile_read16(refs+ref));
 }
 
+static nvm_class_hdr_t *nvmfile_get_class_hdr(u08_t index) {
+#ifdef NVM_USE_LIBRARY
+  if(index >= NVMLIB_CLASS_BASE)
+    return &((nvm_header_t*)nvmlib)->class_hdr[index-NVMLIB_CLASS_BASE];
+#endif
+
+  return &((nvm_header_t*)nvmfile)->class_hdr[index];
+}
+
 u08_t nvmfile_get_class_fields(u08_t index) {
-  return nvmfile_read08(&((nvm_header_t*)nvmfile)->class_hdr[index].fields);
+  return nvmfile_read08(&nvmfile_get_class_hdr(index)->fields);
 }
 
 u08_t nvmfile_get_static_fields(void) {
   return nvmfile_read08(&((nvm_header_t*)nvmfile)->static_fields);
 }
 
-#ifdef NVM_USE_INHERITANCE
-u08_t nvmfile_get_method_by_fixed_class_and_id(u08_t class, u08_t id) {
-  u08_t i;
+#if defined(NVM_USE_INHERITANCE) || defined(NVM_USE_LIBRARY)
+static u16_t nvmfile_get_method_by_fixed_class_and_id(u08_t class, u08_t id) {
+  u08_t i, *image = (u08_t*)nvmfile;
+  u16_t base = 0;
   nvm_method_hdr_t mhdr, *mhdr_ptr;
 
   DEBUGF("Searching for class "DBG8", method "DBG8"\n", class, id);
 
-  for(i=0;i<nvmfile_read08(&((nvm_header_t*)nvmfile)->methods);i++) {
+#ifdef NVM_USE_LIBRARY
+  // methods of library classes only exist in the library
+  if(class >= NVMLIB_CLASS_BASE) {
+    image = (u08_t*)nvmlib;
+    base = NVMLIB_METHOD_BASE;
+  }
+#endif
+
+  for(i=0;i<nvmfile_read08(&((nvm_header_t*)image)->methods);i++) {
     DEBUGF("Method %d ", i);
     // load new method header into ram
-    mhdr_ptr = nvmfile_get_method_hdr(i);
+    mhdr_ptr = nvmfile_get_method_hdr(base+i);
     nvmfile_read(&mhdr, mhdr_ptr, sizeof(nvm_method_hdr_t));
     DEBUGF("id = #"DBG16"\n", mhdr.id);
 
     if(((mhdr.id >> 8) == class) && ((mhdr.id & 0xff) == id)) {
       DEBUGF("Match!\n");
-      return i;
+      return base+i;
     }
   }
 
   DEBUGF("No matching method in this class\n");
-  return 0xff;
+  return 0xffff;
 }
+#endif
 
-u08_t nvmfile_get_method_by_class_and_id(u08_t class, u08_t id) {
-  u08_t mref;
+#ifdef NVM_USE_INHERITANCE
+// 0xffff if neither the class nor one of its super classes has it
+u16_t nvmfile_get_method_by_class_and_id(u08_t class, u08_t id) {
+  u16_t mref;
 
-  for(;;) {
-    if((mref = nvmfile_get_method_by_fixed_class_and_id(class, id)) != 0xff)
+  while(class < NATIVE_CLASS_BASE) {
+    if((mref = nvmfile_get_method_by_fixed_class_and_id(class, id)) != 0xffff)
       return mref;
 
     DEBUGF("Getting super class of %d ", class);
-    class = nvmfile_read08(&((nvm_header_t*)nvmfile)->class_hdr[class].super);
+    class = nvmfile_read08(&nvmfile_get_class_hdr(class)->super);
     DEBUGF("-> %d\n", class);
   }
 
-  return 0;
+  return 0xffff;
 }
 #endif
@@ -55,13 +55,23 @@ typedef struct {
 
 // marker that indicates, that a method is a classes init method
 #define FLAG_CLINIT 1
+// marker that indicates, that a method is an import of a library method
+#define FLAG_IMPORT 2
 
+// NanoVMTool gives run()V this method id in every class
+#define NVMFILE_METHOD_ID_RUN  0
+
+#ifndef NVM_USE_CONTEXT
 extern u08_t nvmfile_constant_count;
+#endif
 
-void   nvmfile_store(u16_t index, u08_t *buffer, u16_t size);
+void   nvmfile_store(u16_t index, u08_t *buffer, u32_t size);
 
 bool_t nvmfile_init(void);
 void   nvmfile_call_main(void);
+#ifdef NVM_USE_SLICE
+void   nvmfile_start_main(void);
+#endif
 void   *nvmfile_get_addr(u16_t ref);
 u08_t  nvmfile_get_class_fields(u08_t index);
 u08_t  nvmfile_get_static_fields(void);
@@ -73,7 +83,8 @@ u16_t  nvmfile_read16(void *addr);
 u32_t  nvmfile_read32(void *addr);
 void   nvmfile_write08(void *addr, u08_t data);
 void   *nvmfile_get_base(void);
-u08_t  nvmfile_get_method_by_class_and_id(u08_t class, u08_t id);
+u32_t  nvmfile_get_avail(void *addr);
+u16_t  nvmfile_get_method_by_class_and_id(u08_t class, u08_t id);
 
 nvm_method_hdr_t *nvmfile_get_method_hdr(u16_t index);
 
@@ -87,10 +98,30 @@ void nvmfile_write_finalize(void);
 
 #ifdef UNIX
 void nvmfile_load(char *filename, bool_t quiet);
+#ifdef NVM_USE_CONTEXT
+extern u08_t nvmfile_default[];
+bool_t nvmfile_load_image(const u08_t *image, u32_t size);
+void nvmfile_unload(void);
+#endif
+#endif
+
+#ifdef NVM_USE_LIBRARY
+u16_t  nvmfile_resolve(u16_t index);
+u32_t  nvmlib_get_constant(u08_t index);
+#ifdef UNIX
+void   nvmlib_load(char *filename, bool_t quiet);
+#endif
 #endif
 
 #define NVMFILE_SET(a)     (void*)(((ptr_t)a) | NVMFILE_FLAG)
+#if defined(UNIX) && defined(__LP64__)
+// buffers on the C stack of a 64 bit host lie above 4 GB, cutting
+// their address down to a ptr_t may leave anything in the flag bit
+#define NVMFILE_ISSET(a)   (!(((unsigned long)a) >> 32) && \
+			    (((ptr_t)a) & NVMFILE_FLAG))
+#else
 #define NVMFILE_ISSET(a)   (((ptr_t)a) & NVMFILE_FLAG)
+#endif
 #define NVMFILE_ADDR(a)    (void*)(((ptr_t)a) & ~NVMFILE_FLAG)
 
 #endif // NVMFILE_H
@@ -0,0 +1,426 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+//
+//  nvmfloat.c, float to string conversion using integer arithmetic only
+//
+//  The float is split into its integer part and a binary fraction,
+//  both held exactly in 16 bit limbs. Integer digits are produced by
+//  dividing by 10, fraction digits by multiplying by 10, so the
+//  digits are exact and rounding (half to even) matches the libc.
+//
+
+#include "types.h"
+#include "debug.h"
+#include "config.h"
+#include "error.h"
+
+#ifdef NVM_USE_FLOAT
+
+#include "vm.h"
+#include "nvmfloat.h"
+
+// 2^129 needs 9 limbs, a fraction of 2^-150 plus 4 bits for the
+// next digit needs 10 limbs
+#define NVMFLOAT_LIMBS   10
+
+// mantissa bits, one more than a float has for the midpoints
+// between two floats and one more for the power of two case
+#define NVMFLOAT_MANT    26
+
+typedef struct {
+  u16_t num[NVMFLOAT_LIMBS];  // fraction numerator, denominator 2^bits
+  u08_t bits;
+  char idig[NVMFLOAT_DIGS];   // integer digits, least significant first
+  u08_t ilen;
+} nvmfloat_t;
+
+static void nvmfloat_init(nvmfloat_t *s, u32_t mant, s16_t e2) {
+  u08_t i;
+
+  for(i=0;i<NVMFLOAT_LIMBS;i++)
+    s->num[i] = 0;
+  s->ilen = 0;
+  s->bits = (e2 < 0)?-e2:0;
+
+  // place all mantissa bits at or above the binary point into num
+  for(i=0;i<NVMFLOAT_MANT;i++) {
+    s16_t b = i + e2;
+    if((mant & (1L<<i)) && (b >= 0))
+      s->num[b/16] |= 1U<<(b%16);
+  }
+
+  // convert integer part to decimal digits
+  bool_t zero;
+  do {
+    u32_t rem = 0;
+
+    zero = TRUE;
+    for(i=NVMFLOAT_LIMBS;i--;) {
+      rem = (rem<<16) | s->num[i];
+      s->num[i] = rem/10;
+      rem %= 10;
+      if(s->num[i]) zero = FALSE;
+    }
+    s->idig[s->ilen++] = '0' + rem;
+  } while(!zero);
+
+  // a zero integer part produces no digit at all
+  if((s->ilen == 1) && (s->idig[0] == '0'))
+    s->ilen = 0;
+
+  // and the remaining bits below the binary point are the fraction
+  for(i=0;i<NVMFLOAT_MANT;i++) {
+    s16_t b = i + e2;
+    if((mant & (1L<<i)) && (b < 0))
+      s->num[(b+s->bits)/16] |= 1U<<((b+s->bits)%16);
+  }
+}
+
+// next fraction digit: multiply by 10 and take the bits above the point
+static char nvmfloat_frac_digit(nvmfloat_t *s) {
+  u08_t i, l = s->bits/16, o = s->bits%16;
+  u32_t c = 0;
+
+  for(i=0;i<NVMFLOAT_LIMBS;i++) {
+    c += (u32_t)s->num[i]*10;
+    s->num[i] = c;
+    c >>= 16;
+  }
+
+  c = s->num[l];
+  if(l+1 < NVMFLOAT_LIMBS) {
+    c |= (u32_t)s->num[l+1]<<16;
+    s->num[l+1] = 0;
+  }
+  s->num[l] &= (1U<<o)-1;
+  return '0' + (c>>o);
+}
+
+static char nvmfloat_next(nvmfloat_t *s) {
+  if(s->ilen)
+    return s->idig[--s->ilen];
+  return nvmfloat_frac_digit(s);
+}
+
+// anything left behind the current digit?
+static bool_t nvmfloat_sticky(nvmfloat_t *s) {
+  u08_t i;
+
+  for(i=0;i<s->ilen;i++)
+    if(s->idig[i] != '0') return TRUE;
+  for(i=0;i<NVMFLOAT_LIMBS;i++)
+    if(s->num[i]) return TRUE;
+  return FALSE;
+}
+
+// split |val| into mantissa and binary exponent, val = mant * 2^e2
+static u32_t nvmfloat_split(nvm_float_t val, s16_t *e2) {
+  nvm_union_t v;
+  u32_t mant;
+
+  v.f[0] = val;
+  mant = v.i[0] & 0x7fffffL;
+  *e2 = (v.i[0]>>23) & 0xff;
+  if(*e2) mant |= 0x800000L, *e2 -= 150;
+  else    *e2 = -149;
+
+  return mant;
+}
+
+// Generate the decimal digits of |val| into buf, rounded half to even.
+// With fixed set prec is the number of digits behind the decimal point,
+// otherwise the number of significant digits. Returns the decimal
+// exponent of the first digit, cnt is set to the number of digits
+// (0 if the value rounds to zero).
+s08_t nvmfloat_digits(nvm_float_t val, char *buf, u08_t *cnt,
+                      u08_t prec, bool_t fixed) {
+  nvmfloat_t s;
+  s16_t n, e2;
+  s08_t exp;
+  char d;
+  u32_t mant = nvmfloat_split(val, &e2);
+
+  if(!mant) {
+    n = fixed?prec+1:prec;
+    if(n > NVMFLOAT_DIGS) n = NVMFLOAT_DIGS;
+    for(*cnt=0; *cnt<n; (*cnt)++)
+      buf[*cnt] = '0';
+    return 0;
+  }
+
+  nvmfloat_init(&s, mant, e2);
+
+  // skip leading zeros
+  exp = s.ilen-1;
+  while((d = nvmfloat_next(&s)) == '0')
+    exp--;
+
+  n = fixed?exp+1+prec:prec;
+  if(n > NVMFLOAT_DIGS) n = NVMFLOAT_DIGS;
+
+  *cnt = 0;
+  if(n < 0)
+    return exp;     // less than half of the last digit
+
+  if(n > 0) {
+    buf[(*cnt)++] = d;
+    while(*cnt < n)
+      buf[(*cnt)++] = nvmfloat_next(&s);
+    d = nvmfloat_next(&s);
+  }
+
+  // round half to even
+  if((d > '5') || ((d == '5') &&
+     (nvmfloat_sticky(&s) || (*cnt && (buf[*cnt-1] & 1))))) {
+    u08_t i = *cnt;
+    while(i && (buf[i-1] == '9'))
+      buf[--i] = '0';
+
+    if(i)
+      buf[i-1]++;
+    else {
+      // carry out of the first digit, 99.9 -> 100
+      buf[0] = '1';
+      exp++;
+      if(!*cnt)
+        *cnt = 1;
+      else if(fixed && (*cnt < NVMFLOAT_DIGS))
+        buf[(*cnt)++] = '0';
+    }
+  }
+
+  return exp;
+}
+
+// compare the digits in buf, the first one of weight 10^exp, with
+// the exact value mant * 2^e2, returns <0, 0 or >0 like strcmp()
+static s08_t nvmfloat_compare(char *buf, u08_t cnt, s08_t exp,
+                              u32_t mant, s16_t e2) {
+  nvmfloat_t s;
+  s08_t e;
+  u08_t i;
+  char d;
+
+  nvmfloat_init(&s, mant, e2);
+
+  e = s.ilen-1;
+  while((d = nvmfloat_next(&s)) == '0')
+    e--;
+
+  if(exp != e)
+    return (exp > e)?1:-1;
+
+  for(i=0;i<cnt;i++) {
+    if(buf[i] != d)
+      return (buf[i] > d)?1:-1;
+    d = nvmfloat_next(&s);
+  }
+
+  return ((d != '0') || nvmfloat_sticky(&s))?-1:0;
+}
+
+// The number of significant digits (at most 9) needed to read val
+// back as the same float. The rounded digits have to lie between the
+// midpoints to the neighbouring floats, on a midpoint only with an
+// even mantissa since reading rounds half to even. Values below 10^9
+// get enough digits for %g to keep them in fixed notation ("100").
+u08_t nvmfloat_shortest(nvm_float_t val) {
+  char digs[9];
+  s16_t e2;
+  u32_t mant = nvmfloat_split(val, &e2);
+  u08_t prec, cnt;
+  s08_t exp, lo, hi;
+
+  if(!mant || (e2 > 104))
+    return 1;     // zero, inf and nan
+
+  for(prec=1;prec<9;prec++) {
+    exp = nvmfloat_digits(val, digs, &cnt, prec, FALSE);
+
+    // the float below a power of two is only half as far away
+    if((mant == 0x800000L) && (e2 > -149))
+      lo = nvmfloat_compare(digs, cnt, exp, 4*mant-1, e2-2);
+    else
+      lo = nvmfloat_compare(digs, cnt, exp, 2*mant-1, e2-1);
+    hi = nvmfloat_compare(digs, cnt, exp, 2*mant+1, e2-1);
+
+    if((mant & 1)?((lo > 0) && (hi < 0)):((lo >= 0) && (hi <= 0)))
+      break;
+  }
+
+  if((exp >= prec) && (exp < 9))
+    prec = exp+1;
+
+  return prec;
+}
+
+// digit of weight 10^w
+static char nvmfloat_digit(char *buf, u08_t cnt, s08_t exp, s08_t w) {
+  s16_t i = exp - w;
+  return ((i >= 0) && (i < cnt))?buf[i]:'0';
+}
+
+// %a, the exact value in hex, normalized like the libc does for doubles
+static u08_t nvmfloat_hex(char *res, u32_t bits, u08_t prec,
+                          u08_t flags, bool_t upper) {
+  char *p = res;
+  char a = upper?'A':'a';
+  u32_t mant = (bits & 0x7fffffL)<<1;   // 24 bits, 6 hex digits
+  s16_t e = (bits>>23) & 0xff;
+  u08_t nd = 6, lead = 1;
+
+  if(!e && !mant)
+    lead = 0;
+  else if(!e) {
+    // denormal
+    e = -126;
+    while(!(mant & 0x1000000L))
+      mant <<= 1, e--;
+    mant &= 0xffffffL;
+  } else
+    e -= 127;
+
+  if(prec == NVMFLOAT_DEFAULT) {
+    while(nd && !(mant & 0xf))
+      mant >>= 4, nd--;
+    prec = nd;
+  } else if(prec < 6) {
+    u08_t sh = 4*(6-prec);
+    u32_t all = ((u32_t)lead<<24) | mant;
+    u32_t rest = all & ((1L<<sh)-1), half = 1L<<(sh-1);
+
+    all >>= sh;
+    if((rest > half) || ((rest == half) && (all & 1)))
+      all++;
+    nd = prec;
+    lead = all>>(4*nd);
+    mant = all & ((1L<<(4*nd))-1);
+  }
+
+  *p++ = '0';
+  *p++ = upper?'X':'x';
+  *p++ = '0' + lead;
+  if(prec || (flags & NVMFLOAT_ALT))
+    *p++ = '.';
+  while(prec) {
+    u08_t h = 0;
+    if(nd) h = (mant>>(4*--nd)) & 0xf;
+    *p++ = (h>9)?(a+h-10):('0'+h);
+    prec--;
+  }
+
+  *p++ = upper?'P':'p';
+  if(e < 0) *p++ = '-', e = -e;
+  else      *p++ = '+';
+  if(e >= 100) *p++ = '0' + e/100;
+  if(e >= 10)  *p++ = '0' + (e/10)%10;
+  *p++ = '0' + e%10;
+
+  return p-res;
+}
+
+// Format val like printf does for the conversions f, e, g and a (and
+// their upper case versions). Returns the length, res is not
+// terminated and must have room for NVMFLOAT_LEN chars.
+u08_t nvmfloat_format(char *res, nvm_float_t val, char conv,
+                      u08_t prec, u08_t flags) {
+  char digs[NVMFLOAT_DIGS];
+  char *p = res;
+  bool_t upper = (conv >= 'A') && (conv <= 'Z');
+  nvm_union_t v;
+  u08_t cnt;
+  s08_t exp, w;
+
+  v.f[0] = val;
+  conv |= 0x20;   // lower case
+
+  if(v.i[0] < 0)                *p++ = '-';
+  else if(flags & NVMFLOAT_PLUS)  *p++ = '+';
+  else if(flags & NVMFLOAT_SPACE) *p++ = ' ';
+
+  if(((v.i[0]>>23) & 0xff) == 0xff) {
+    char *s = (v.i[0] & 0x7fffffL)?"nan":"inf";
+    while(*s)
+      *p++ = upper?(*s++ - 'a' + 'A'):*s++;
+    return p-res;
+  }
+
+  if(prec != NVMFLOAT_DEFAULT && prec > 30)
+    prec = 30;
+
+  if(conv == 'a')
+    return (p-res) + nvmfloat_hex(p, v.i[0], prec, flags, upper);
+
+  if(prec == NVMFLOAT_DEFAULT)
+    prec = 6;
+
+  if(conv == 'e') {
+    exp = nvmfloat_digits(val, digs, &cnt, prec+1, FALSE);
+  } else if(conv == 'f') {
+    exp = nvmfloat_digits(val, digs, &cnt, prec, TRUE);
+    // keep the result within NVMFLOAT_DIGS digits
+    if((exp >= 0) && (exp+1+prec > NVMFLOAT_DIGS))
+      prec = (exp+1 < NVMFLOAT_DIGS)?NVMFLOAT_DIGS-exp-1:0;
+  } else {
+    // g: the shorter of e and f for the given number of digits
+    if(!prec) prec = 1;
+    exp = nvmfloat_digits(val, digs, &cnt, prec, FALSE);
+    if((exp < -4) || (exp >= prec)) {
+      conv = 'e';
+      prec--;
+    } else {
+      conv = 'f';
+      prec -= exp+1;
+    }
+
+    if(!(flags & NVMFLOAT_ALT))
+      while(prec && cnt && (digs[cnt-1] == '0'))
+        prec--, cnt--;
+  }
+
+  if(conv == 'e') {
+    *p++ = nvmfloat_digit(digs, cnt, 0, 0);
+    if(prec || (flags & NVMFLOAT_ALT))
+      *p++ = '.';
+    for(w=-1; w>=-prec; w--)
+      *p++ = nvmfloat_digit(digs, cnt, 0, w);
+
+    *p++ = upper?'E':'e';
+    if(exp < 0) *p++ = '-', exp = -exp;
+    else        *p++ = '+';
+    *p++ = '0' + exp/10;
+    *p++ = '0' + exp%10;
+  } else {
+    if(cnt && (exp >= 0)) {
+      for(w=exp; w>=0; w--)
+        *p++ = nvmfloat_digit(digs, cnt, exp, w);
+    } else
+      *p++ = '0';
+
+    if(prec || (flags & NVMFLOAT_ALT))
+      *p++ = '.';
+    for(w=-1; w>=-prec; w--)
+      *p++ = nvmfloat_digit(digs, cnt, exp, w);
+  }
+
+  return p-res;
+}
+
+#endif // NVM_USE_FLOAT
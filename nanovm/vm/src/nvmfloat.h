@@ -0,0 +1,42 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+//
+//  nvmfloat.h
+//
+
+#ifndef NVMFLOAT_H
+#define NVMFLOAT_H
+
+// format flags, same bits as used by the formatter
+#define NVMFLOAT_ALT     0x02   // '#', always print the decimal point
+#define NVMFLOAT_PLUS    0x04   // '+', sign in front of positive numbers
+#define NVMFLOAT_SPACE   0x08   // ' ', space in front of positive numbers
+
+#define NVMFLOAT_DEFAULT 255    // no precision given
+#define NVMFLOAT_DIGS    40     // max number of generated digits
+#define NVMFLOAT_LEN     43     // max length of a formatted number
+
+s08_t nvmfloat_digits(nvm_float_t val, char *buf, u08_t *cnt,
+                      u08_t prec, bool_t fixed);
+u08_t nvmfloat_format(char *res, nvm_float_t val, char conv,
+                      u08_t prec, u08_t flags);
+u08_t nvmfloat_shortest(nvm_float_t val);
+
+#endif // NVMFLOAT_H
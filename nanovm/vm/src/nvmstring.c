@@ -61,27 +61,57 @@ void native_strncat(char *dst, char *src, int n) {
 
 #endif
 
+// Return the next piece of the string at *str and its length in *len.
+// Strings in ram are returned in one piece, strings in the nvm file are
+// copied to buf in chunks that don't cross a NVMSTRING_CHUNK boundary, so
+// reading never goes beyond the storage page holding the terminating
+// zero. The last chunk ends with the image. *str is advanced and set to
+// NULL once the end has been reached.
+char *native_strchunk(char *buf, char **str, u16_t *len) {
+  char *src = *str;
+  u32_t avail;
+  u16_t n;
+
+  if(!NVMFILE_ISSET(src)) {
+    *len = utils_strlen(src);
+    *str = NULL;
+    return src;
+  }
+
+  n = NVMSTRING_CHUNK - ((ptr_t)src & (NVMSTRING_CHUNK-1));
+  if(n > (avail = nvmfile_get_avail(src)))
+    n = avail;
+  nvmfile_read(buf, src, n);
+
+  for(*len=0;(*len < n) && buf[*len];(*len)++);
+  *str = ((*len < n) || !n)?NULL:src + n;
+  return buf;
+}
+
 /* string copy to ram */
 void native_strcpy(char *dst, char* src) {
-
-  // check if string resides in nvm file memory (e.g. eeprom)
-  if(NVMFILE_ISSET(src))
-    while((*dst++ = nvmfile_read08(src++)));
-  else 
-    while((*dst++ = *src++));
+  char buf[NVMSTRING_CHUNK], *chunk;
+  u16_t len;
+
+  while(src) {
+    chunk = native_strchunk(buf, &src, &len);
+    utils_memcpy(dst, chunk, len);
+    dst += len;
+  }
+  *dst = 0;
 }
 
 /* determine string length */
 u16_t native_strlen(char *str) {
-  u16_t len=0;
+  char buf[NVMSTRING_CHUNK];
+  u16_t len, total = 0;
 
-  // check if string resides in nvm file memory (e.g. eeprom)
-  if(NVMFILE_ISSET(str))
-    while(nvmfile_read08(str++)) len++;
-  else
-    while(*str++) len++;
+  while(str) {
+    native_strchunk(buf, &str, &len);
+    total += len;
+  }
   
-  return len;
+  return total;
 }
 
 // append a string to another one
@@ -24,6 +24,10 @@
 #ifndef NVM_STRING_H
 #define NVM_STRING_H
 
+// size of the chunks nvm file strings are read in, power of two
+#define NVMSTRING_CHUNK  16
+
+char *native_strchunk(char *buf, char **str, u16_t *len);
 void native_strcpy(char *dst, char* src);
 void native_strncpy(char *dst, char* src, int n);
 u16_t native_strlen(char *str);
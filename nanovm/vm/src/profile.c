@@ -0,0 +1,213 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+//
+//  profile.c
+//
+//  Counting profiler for the unix version. Counts the executions
+//  of every opcode, the calls and the executed instructions of
+//  every method and the calls of every native method. The result
+//  is written as JSON when the vm exits.
+//
+//  Exclusive counts are the instructions of the method itself,
+//  inclusive counts add those of all methods called by it. A
+//  recursive method is only counted once in its inclusive count.
+//
+
+#include "types.h"
+#include "config.h"
+#include "debug.h"
+
+#ifdef NVM_USE_PROFILE
+
+#ifndef UNIX
+#error "NVM_USE_PROFILE is only supported by the unix version"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "nvmfile.h"
+#include "native.h"
+#include "profile.h"
+#include "symbols.h"
+
+// application methods and (behind them) library methods
+#define PROFILE_METHODS  256
+#ifdef NVM_USE_LIBRARY
+#define PROFILE_SLOTS    (2*PROFILE_METHODS)
+#else
+#define PROFILE_SLOTS    PROFILE_METHODS
+#endif
+
+#define PROFILE_NATIVE_CLASSES  64
+#define PROFILE_NATIVE_METHODS  64
+
+// the vm stack lives in the heap, so calls can't nest very deep
+#define PROFILE_DEPTH    256
+
+typedef struct {
+  u32_t calls;
+  u32_t exclusive;
+  u32_t inclusive;
+  u16_t active;       // number of frames of this method on the stack
+} profile_method_t;
+
+typedef struct {
+  u16_t slot;
+  u32_t start;        // instruction count when the method was entered
+} profile_frame_t;
+
+bool_t profile_enabled = FALSE;
+
+static char *profile_file;
+static u32_t profile_instructions;
+static u32_t profile_opcodes[256];
+static profile_method_t profile_methods[PROFILE_SLOTS];
+static u32_t profile_natives[PROFILE_NATIVE_CLASSES][PROFILE_NATIVE_METHODS];
+static profile_frame_t profile_stack[PROFILE_DEPTH];
+static u16_t profile_depth;
+
+static u16_t profile_slot(u16_t mref) {
+#ifdef NVM_USE_LIBRARY
+  if(NVMLIB_IS_METHOD(mref))
+    return PROFILE_METHODS + ((mref - NVMLIB_METHOD_BASE) % PROFILE_METHODS);
+#endif
+  return mref % PROFILE_METHODS;
+}
+
+void profile_enable(char *filename) {
+  profile_file = filename;
+  profile_enabled = TRUE;
+  atexit(profile_dump);
+}
+
+void profile_instr(u08_t instr) {
+  profile_instructions++;
+  profile_opcodes[instr]++;
+
+  if(profile_depth && (profile_depth <= PROFILE_DEPTH))
+    profile_methods[profile_stack[profile_depth-1].slot].exclusive++;
+}
+
+void profile_call(u16_t mref) {
+  u16_t slot = profile_slot(mref);
+
+  profile_methods[slot].calls++;
+  profile_methods[slot].active++;
+
+  if(profile_depth < PROFILE_DEPTH) {
+    profile_stack[profile_depth].slot = slot;
+    profile_stack[profile_depth].start = profile_instructions;
+  }
+  profile_depth++;
+}
+
+void profile_return(void) {
+  profile_frame_t *f;
+
+  if(!profile_depth)
+    return;
+
+  if(--profile_depth >= PROFILE_DEPTH)
+    return;
+
+  // only the outermost frame of a recursion counts
+  f = &profile_stack[profile_depth];
+  if(!--profile_methods[f->slot].active)
+    profile_methods[f->slot].inclusive += profile_instructions - f->start;
+}
+
+void profile_native(u16_t mref) {
+  u08_t class = NATIVE_ID2CLASS(mref) - NATIVE_CLASS_BASE;
+  u08_t method = NATIVE_ID2METHOD(mref);
+
+  if((class < PROFILE_NATIVE_CLASSES) && (method < PROFILE_NATIVE_METHODS))
+    profile_natives[class][method]++;
+}
+
+static u16_t profile_mref(u16_t slot) {
+#ifdef NVM_USE_LIBRARY
+  if(slot >= PROFILE_METHODS)
+    return NVMLIB_METHOD_BASE + slot - PROFILE_METHODS;
+#endif
+  return slot;
+}
+
+void profile_dump(void) {
+  FILE *out;
+  u16_t i, j;
+  char *sep;
+
+  if(!profile_enabled)
+    return;
+  profile_enabled = FALSE;
+
+  // frames still active (e.g. after a vm error) end now
+  while(profile_depth)
+    profile_return();
+
+  if(!(out = fopen(profile_file, "w"))) {
+    perror(profile_file);
+    return;
+  }
+
+  fprintf(out, "{\n  \"instructions\": %lu,\n",
+	  (unsigned long)profile_instructions);
+
+  fprintf(out, "  \"opcodes\": [");
+  for(sep="\n",i=0;i<256;i++) {
+    if(!profile_opcodes[i]) continue;
+    fprintf(out, "%s    {\"opcode\": %u, \"count\": %lu}", sep, i,
+	    (unsigned long)profile_opcodes[i]);
+    sep = ",\n";
+  }
+  fprintf(out, "\n  ],\n");
+
+  fprintf(out, "  \"methods\": [");
+  for(sep="\n",i=0;i<PROFILE_SLOTS;i++) {
+    profile_method_t *m = &profile_methods[i];
+    if(!m->calls) continue;
+    fprintf(out, "%s    {\"mref\": %u, ", sep, profile_mref(i));
+#ifdef NVM_USE_SYMBOLS
+    if(symbols_method(profile_mref(i)))
+      fprintf(out, "\"name\": \"%s\", ", symbols_method(profile_mref(i)));
+#endif
+    fprintf(out, "\"calls\": %lu, \"exclusive\": %lu, \"inclusive\": %lu}",
+	    (unsigned long)m->calls, (unsigned long)m->exclusive,
+	    (unsigned long)m->inclusive);
+    sep = ",\n";
+  }
+  fprintf(out, "\n  ],\n");
+
+  fprintf(out, "  \"natives\": [");
+  for(sep="\n",i=0;i<PROFILE_NATIVE_CLASSES;i++) {
+    for(j=0;j<PROFILE_NATIVE_METHODS;j++) {
+      if(!profile_natives[i][j]) continue;
+      fprintf(out, "%s    {\"class\": %u, \"method\": %u, \"calls\": %lu}",
+	      sep, i + NATIVE_CLASS_BASE, j, (unsigned long)profile_natives[i][j]);
+      sep = ",\n";
+    }
+  }
+  fprintf(out, "\n  ]\n}\n");
+
+  fclose(out);
+}
+
+#endif // NVM_USE_PROFILE
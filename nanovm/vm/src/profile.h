@@ -0,0 +1,53 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+//
+//  profile.h
+//
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include "types.h"
+#include "config.h"
+
+#ifdef NVM_USE_PROFILE
+
+extern bool_t profile_enabled;
+
+void profile_enable(char *filename);
+void profile_instr(u08_t instr);
+void profile_call(u16_t mref);
+void profile_return(void);
+void profile_native(u16_t mref);
+void profile_dump(void);
+
+// the checks are inlined, so a disabled profiler costs one compare
+#define PROFILE_INSTR(i)   do { if(profile_enabled) profile_instr(i); } while(0)
+#define PROFILE_CALL(m)    do { if(profile_enabled) profile_call(m); } while(0)
+#define PROFILE_RETURN()   do { if(profile_enabled) profile_return(); } while(0)
+#define PROFILE_NATIVE(m)  do { if(profile_enabled) profile_native(m); } while(0)
+#else
+#define PROFILE_INSTR(i)
+#define PROFILE_CALL(m)
+#define PROFILE_RETURN()
+#define PROFILE_NATIVE(m)
+#endif
+
+#endif // PROFILE_H
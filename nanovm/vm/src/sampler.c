@@ -0,0 +1,269 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+//
+//  sampler.c
+//
+//  Statistical profiler for the unix version. A SIGPROF timer
+//  interrupts the vm every SAMPLER_INTERVAL us of cpu time. The
+//  handler takes the method and bytecode offset of the current
+//  instruction and walks up to SAMPLER_DEPTH frames through the
+//  return records vm_run pushes on invocation (pc offset, method
+//  reference, locals offset). The samples are summed up in fixed
+//  tables, at exit a flat profile, the hottest source lines and
+//  the sampled calls are written as text.
+//
+
+#include "types.h"
+#include "config.h"
+#include "debug.h"
+
+#ifdef NVM_USE_SAMPLER
+
+#ifndef UNIX
+#error "NVM_USE_SAMPLER is only supported by the unix version"
+#endif
+
+#ifndef NVM_USE_SYMBOLS
+#error "NVM_USE_SAMPLER requires NVM_USE_SYMBOLS"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/time.h>
+
+#include "vm.h"
+#include "heap.h"
+#include "nvmfile.h"
+#include "symbols.h"
+#include "sampler.h"
+
+#ifndef SAMPLER_INTERVAL
+#define SAMPLER_INTERVAL 1000   // us of cpu time between samples
+#endif
+
+#define SAMPLER_DEPTH    8      // frames walked per sample
+#define SAMPLER_METHODS  256
+#define SAMPLER_SLOTS    1024   // hash table for lines and calls
+
+// pc offset, method reference and locals offset pushed on invocation
+#define SAMPLER_FRAME    3
+
+typedef struct {
+  u32_t key;          // 0 = unused
+  u32_t count;
+} sampler_slot_t;
+
+nvm_stack_t *sampler_locals_base;
+
+static char *sampler_file;
+static u32_t sampler_samples;
+static u32_t sampler_lost;           // tables full
+static u32_t sampler_self[SAMPLER_METHODS];
+static u32_t sampler_total[SAMPLER_METHODS];
+static sampler_slot_t sampler_pcs[SAMPLER_SLOTS];    // mref<<16 | pc
+static sampler_slot_t sampler_calls[SAMPLER_SLOTS];  // caller<<16 | callee
+
+static u16_t sampler_method(u16_t mref) {
+#ifdef NVM_USE_LIBRARY
+  // library methods share the upper half
+  if(NVMLIB_IS_METHOD(mref))
+    return SAMPLER_METHODS/2 + (mref - NVMLIB_METHOD_BASE) % (SAMPLER_METHODS/2);
+#endif
+  return mref % SAMPLER_METHODS;
+}
+
+static void sampler_count(sampler_slot_t *table, u32_t key) {
+  u16_t i, h = (key ^ (key >> 13)) % SAMPLER_SLOTS;
+
+  // the top bit marks used slots
+  key |= 0x80000000L;
+
+  for(i=0;i<SAMPLER_SLOTS;i++,h=(h+1)%SAMPLER_SLOTS) {
+    if(table[h].key == key) {
+      table[h].count++;
+      return;
+    }
+    if(!table[h].key) {
+      table[h].key = key;
+      table[h].count = 1;
+      return;
+    }
+  }
+  sampler_lost++;
+}
+
+static bool_t sampler_in_heap(nvm_stack_t *p) {
+  u08_t *heap = heap_get_base();
+  return ((u08_t*)p >= heap) && ((u08_t*)p < heap + HEAPSIZE);
+}
+
+static void sampler_signal(int sig) {
+  u16_t stack[SAMPLER_DEPTH];
+  nvm_stack_t *l = VM_LOCALS;
+  u08_t depth = 0, i, j, methods;
+  u16_t mref = SYMBOLS_MREF;
+
+  (void)sig;
+
+  if(mref == 0xffff || !sampler_locals_base)
+    return;
+
+  sampler_samples++;
+  sampler_self[sampler_method(mref)]++;
+  sampler_count(sampler_pcs, ((u32_t)mref << 16) | SYMBOLS_PC);
+
+  // walk the return records up to the outermost method. The signal may
+  // hit an invocation half done, so everything read is checked
+  methods = nvmfile_read08(&((nvm_header_t*)nvmfile_get_base())->methods);
+  stack[depth++] = mref;
+  while((depth < SAMPLER_DEPTH) && (l > sampler_locals_base) &&
+	(mref < methods)) {
+    nvm_method_hdr_t *hdr = nvmfile_get_method_hdr(mref);
+    nvm_stack_t *rec = l + nvmfile_read08(&hdr->max_locals);
+
+    if(!sampler_in_heap(rec) || !sampler_in_heap(rec + SAMPLER_FRAME - 1))
+      break;
+
+    mref = rec[1];
+    l = l - 1 - rec[2];
+    if(!sampler_in_heap(l))
+      break;
+
+    sampler_count(sampler_calls, ((u32_t)mref << 16) | stack[depth-1]);
+    stack[depth++] = mref;
+  }
+
+  // a method counts once per sample, even when recursive
+  for(i=0;i<depth;i++) {
+    for(j=0;(j<i) && (stack[j] != stack[i]);j++);
+    if(j == i)
+      sampler_total[sampler_method(stack[i])]++;
+  }
+}
+
+static void sampler_name(FILE *out, u16_t mref) {
+  char *name = symbols_method(mref);
+
+  if(name) fprintf(out, "%s", name);
+  else     fprintf(out, "method %u", mref);
+}
+
+static u16_t sampler_mref(u16_t slot) {
+#ifdef NVM_USE_LIBRARY
+  if(slot >= SAMPLER_METHODS/2)
+    return NVMLIB_METHOD_BASE + slot - SAMPLER_METHODS/2;
+#endif
+  return slot;
+}
+
+// print the entries of a table with most samples first
+static void sampler_print_slots(FILE *out, sampler_slot_t *table, bool_t calls) {
+  u32_t last = 0xffffffffL;
+  u16_t i;
+
+  for(;;) {
+    u32_t max = 0;
+
+    // the next lower count
+    for(i=0;i<SAMPLER_SLOTS;i++)
+      if((table[i].count < last) && (table[i].count > max))
+	max = table[i].count;
+    if(!max)
+      break;
+
+    for(i=0;i<SAMPLER_SLOTS;i++) {
+      u16_t hi = (table[i].key >> 16) & 0x7fff, lo = table[i].key & 0xffff;
+      s16_t line;
+
+      if(table[i].count != max)
+	continue;
+
+      fprintf(out, "%8lu  ", (unsigned long)max);
+      sampler_name(out, hi);
+      if(calls) {
+	fprintf(out, " -> ");
+	sampler_name(out, lo);
+      } else {
+	fprintf(out, " pc %u", lo);
+	if((line = symbols_line(hi, lo)) >= 0)
+	  fprintf(out, " (line %d)", line);
+      }
+      fprintf(out, "\n");
+    }
+    last = max;
+  }
+}
+
+static void sampler_dump(void) {
+  struct itimerval timer;
+  FILE *out;
+  u16_t i;
+
+  // stop sampling
+  memset(&timer, 0, sizeof(timer));
+  setitimer(ITIMER_PROF, &timer, NULL);
+
+  if(!(out = fopen(sampler_file, "w"))) {
+    perror(sampler_file);
+    return;
+  }
+
+  fprintf(out, "%lu samples every %u us cpu time",
+	  (unsigned long)sampler_samples, SAMPLER_INTERVAL);
+  if(sampler_lost)
+    fprintf(out, ", %lu not recorded", (unsigned long)sampler_lost);
+  fprintf(out, "\n\nflat profile:\n   self%%    self   total  method\n");
+
+  for(i=0;i<SAMPLER_METHODS;i++) {
+    if(!sampler_total[i])
+      continue;
+    fprintf(out, "%8.1f %7lu %7lu  ", sampler_samples?
+	    100.0*sampler_self[i]/sampler_samples:0.0,
+	    (unsigned long)sampler_self[i], (unsigned long)sampler_total[i]);
+    sampler_name(out, sampler_mref(i));
+    fprintf(out, "\n");
+  }
+
+  fprintf(out, "\nhot spots:\n");
+  sampler_print_slots(out, sampler_pcs, FALSE);
+
+  fprintf(out, "\ncall graph (caller -> callee):\n");
+  sampler_print_slots(out, sampler_calls, TRUE);
+
+  fclose(out);
+}
+
+void sampler_enable(char *filename) {
+  struct itimerval timer;
+
+  sampler_file = filename;
+  symbols_enabled = TRUE;
+  signal(SIGPROF, sampler_signal);
+  atexit(sampler_dump);
+
+  timer.it_interval.tv_sec = 0;
+  timer.it_interval.tv_usec = SAMPLER_INTERVAL;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+#endif // NVM_USE_SAMPLER
@@ -0,0 +1,42 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+//
+//  sampler.h
+//
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include "types.h"
+#include "config.h"
+
+#ifdef NVM_USE_SAMPLER
+
+// locals of the outermost method, the frame walk stops there
+extern nvm_stack_t *sampler_locals_base;
+
+void sampler_enable(char *filename);
+
+#define SAMPLER_BASE(l)  sampler_locals_base = (l)
+#else
+#define SAMPLER_BASE(l)
+#endif
+
+#endif // SAMPLER_H
@@ -29,14 +29,25 @@
 #include "vm.h"
 #include "heap.h"
 #include "stack.h"
+#include "thread.h"
 
 // the stack
+#ifdef NVM_USE_CONTEXT
+#define stack     (nvm_context->stack)
+#define sp        (nvm_context->sp)
+#define stackbase (nvm_context->stackbase)
+#else
 static nvm_stack_t *stack;     // the pysical base of the whole stack (incl. statics)
 static nvm_stack_t *sp;        // the current stack pointer
 static nvm_stack_t *stackbase; // the base of the runtime stack (excl. statics)
+#endif
 
 #ifdef NVM_USE_STACK_CHECK
+#ifdef NVM_USE_CONTEXT
+#define sp_saved  (nvm_context->sp_saved)
+#else
 nvm_stack_t *sp_saved = NULL;
+#endif
 
 // save current stack pointer
 void stack_save_sp(void) {
@@ -66,6 +77,9 @@ void stack_init(u08_t static_fields) {
   // elements the call to a method requires
   stack = (nvm_stack_t*)heap_get_base();
   sp = stack-1;
+#ifdef NVM_USE_STACK_CHECK
+  sp_saved = NULL;  // may be left behind by a vm error
+#endif
 
   // steal one item for mains args and the space required for 
   // the static fields
@@ -160,7 +174,20 @@ bool_t stack_is_empty(void) {
   return(sp == stackbase);
 }
 
-#ifdef DEBUG
+#ifdef NVM_USE_THREADS
+// every thread has a stack of its own, the statics stay in the
+// one of main()
+nvm_stack_t *stack_get_base(void) {
+  return stackbase;
+}
+
+void stack_switch(nvm_stack_t *new_sp, nvm_stack_t *new_base) {
+  sp = new_sp;
+  stackbase = new_base;
+}
+#endif
+
+#if defined(DEBUG) || defined(NVM_USE_TRACE)
 u16_t stack_get_depth(void) {
   return sp-stack;
 }
@@ -170,10 +197,18 @@ bool_t stack_heap_id_in_use(heap_id_t id) {
   // we are searching for heap objects only
   u16_t i;
   nvm_ref_t id16 = id | NVM_TYPE_HEAP;
+  nvm_stack_t *top = sp;
+
+#ifdef NVM_USE_THREADS
+  // sp may belong to another thread than main()
+  if(thread_heap_id_in_use(id16))
+    return TRUE;
+  top = thread_main_sp();
+#endif
 
   // since the locals are physically part of the stack we only need
   // to search the stack
-  for(i=0;i<sp-stack+1;i++) {
+  for(i=0;i<top-stack+1;i++) {
 //    DEBUGF("Stack %d == "DBG16"\n", i, stack[i]);
     if(stack[i] == id16) return TRUE;
   }
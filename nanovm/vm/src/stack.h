@@ -57,7 +57,12 @@ void stack_set_static(u16_t index, nvm_stack_t value);
 void stack_save_base(void);
 bool_t stack_is_empty(void);
 
-#ifdef DEBUG
+#ifdef NVM_USE_THREADS
+nvm_stack_t *stack_get_base(void);
+void stack_switch(nvm_stack_t *new_sp, nvm_stack_t *new_base);
+#endif
+
+#if defined(DEBUG) || defined(NVM_USE_TRACE)
 u16_t stack_get_depth(void);
 #endif
 
@@ -108,6 +108,25 @@
 // nanovm/util/Formatter
 #define NATIVE_CLASS_FORMATTER      (NATIVE_CLASS_BASE+28)
 
+// nanovm/io/Console
+#define NATIVE_CLASS_CONSOLE        (NATIVE_CLASS_BASE+29)
+#define NATIVE_METHOD_WAITAVAILABLE 1
+
+// nanovm/util/Arrays
+#define NATIVE_CLASS_ARRAYS         (NATIVE_CLASS_BASE+30)
+
+// nanovm/util/ArrayMath
+#define NATIVE_CLASS_ARRAYMATH      (NATIVE_CLASS_BASE+31)
+
+// nanovm/lang/Fixed
+#define NATIVE_CLASS_FIXED          (NATIVE_CLASS_BASE+32)
+
+// nanovm/lang/Runtime
+#define NATIVE_CLASS_RUNTIME        (NATIVE_CLASS_BASE+33)
+
+// nanovm/lang/Latency
+#define NATIVE_CLASS_LATENCY        (NATIVE_CLASS_BASE+34)
+
 
 #define NATIVE_ID(c,m)  ((c<<8)|m)
 
@@ -47,10 +47,34 @@
 #include "native_stdio.h"
 #endif
 
+#ifdef NVM_USE_ARRAY
+#include "native_arrays.h"
+#endif
+
 #ifdef NVM_USE_MATH
 #include "native_math.h"
 #endif
 
+#ifdef NVM_USE_ARRAYMATH
+#include "native_arraymath.h"
+#endif
+
+#ifdef NVM_USE_FIXED
+#include "native_fixed.h"
+#endif
+
+#ifdef NVM_USE_HEAP_STATS
+#include "native_runtime.h"
+#endif
+
+#ifdef NVM_USE_LATENCY
+#include "latency.h"
+#endif
+
+#ifdef NVM_USE_THREADS
+#include "thread.h"
+#endif
+
 #ifdef NVM_USE_FORMATTER
 #include "native_formatter.h"
 #endif
@@ -68,47 +92,87 @@ void native_new(u16_t mref) {
 	if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_STRINGBUFFER) {
 		// create empty stringbuf object and push reference onto stack
 		stack_push(NVM_TYPE_HEAP | heap_alloc(FALSE, 1));
-	} else
+	}
+#ifdef NVM_USE_THREADS
+	else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_THREAD)
+		thread_new(mref);
+#endif
+	else
 		error(ERROR_NATIVE_UNKNOWN_CLASS);
 }
 
-void native_invoke(u16_t mref) {
-	// check for native classes/methods
-	if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_OBJECT) {
-		native_java_lang_object_invoke(NATIVE_ID2METHOD(mref));
+// invoke functions of the native classes, indexed by class id
+static NATIVE_DISPATCH_TABLE = {
+	NATIVE_DISPATCH(NATIVE_CLASS_OBJECT, native_java_lang_object_invoke),
 
 #ifdef NVM_USE_STDIO
-	} else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_PRINTSTREAM) {
-		native_java_io_printstream_invoke(NATIVE_ID2METHOD(mref));
-	} else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_INPUTSTREAM) {
-		native_java_io_inputstream_invoke(NATIVE_ID2METHOD(mref));
-	} else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_STRINGBUFFER) {
-		native_java_lang_stringbuffer_invoke(NATIVE_ID2METHOD(mref));
+	NATIVE_DISPATCH(NATIVE_CLASS_PRINTSTREAM, native_java_io_printstream_invoke),
+	NATIVE_DISPATCH(NATIVE_CLASS_INPUTSTREAM, native_java_io_inputstream_invoke),
+	NATIVE_DISPATCH(NATIVE_CLASS_CONSOLE, native_nanovm_io_console_invoke),
+	NATIVE_DISPATCH(NATIVE_CLASS_STRINGBUFFER, native_java_lang_stringbuffer_invoke),
+#endif
+
+#ifdef NVM_USE_ARRAY
+	// array copy, fill and compare
+	NATIVE_DISPATCH(NATIVE_CLASS_SYSTEM, native_java_lang_system_invoke),
+	NATIVE_DISPATCH(NATIVE_CLASS_ARRAYS, native_nanovm_util_arrays_invoke),
 #endif
 
 #ifdef NVM_USE_MATH
 	// the math class
-	} else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_MATH) {
-		native_math_invoke(NATIVE_ID2METHOD(mref));
+	NATIVE_DISPATCH(NATIVE_CLASS_MATH, native_math_invoke),
+#endif
+
+#if defined(NVM_USE_ARRAYMATH) && defined(NVM_USE_ARRAY)
+	// the array math class
+	NATIVE_DISPATCH(NATIVE_CLASS_ARRAYMATH, native_arraymath_invoke),
+#endif
+
+#ifdef NVM_USE_FIXED
+	// the fixed point class
+	NATIVE_DISPATCH(NATIVE_CLASS_FIXED, native_fixed_invoke),
+#endif
+
+#ifdef NVM_USE_HEAP_STATS
+	// heap usage and gc counters
+	NATIVE_DISPATCH(NATIVE_CLASS_RUNTIME, native_runtime_invoke),
+#endif
+
+#ifdef NVM_USE_LATENCY
+	// latency histograms
+	NATIVE_DISPATCH(NATIVE_CLASS_LATENCY, native_latency_invoke),
+#endif
+
+#ifdef NVM_USE_THREADS
+	// green threads
+	NATIVE_DISPATCH(NATIVE_CLASS_THREAD, native_thread_invoke),
 #endif
 
 #ifdef NVM_USE_FORMATTER
 	// the formatter class
-	} else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_FORMATTER) {
-		native_formatter_invoke(NATIVE_ID2METHOD(mref));
+	NATIVE_DISPATCH(NATIVE_CLASS_FORMATTER, native_formatter_invoke),
 #endif
 
 #if defined(STM32) && !defined(OLIMEXINO)
 	// the stm32 specific classes
 	// (not used in olimexino, although its stm32 based)
-	} else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_STM32) {
-		native_stm32_stm32_invoke(NATIVE_ID2METHOD(mref));
-	} else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_GPIO) {
-		native_stm32_gpio_invoke(NATIVE_ID2METHOD(mref));
-	} else if(NATIVE_ID2CLASS(mref) == NATIVE_CLASS_TIMER) {
-		native_stm32_timer_invoke(NATIVE_ID2METHOD(mref));
+	NATIVE_DISPATCH(NATIVE_CLASS_STM32, native_stm32_stm32_invoke),
+	NATIVE_DISPATCH(NATIVE_CLASS_GPIO, native_stm32_gpio_invoke),
+	NATIVE_DISPATCH(NATIVE_CLASS_TIMER, native_stm32_timer_invoke),
 #endif
-	} else
+};
+
+void native_invoke(u16_t mref) {
+	u08_t cls = NATIVE_ID2CLASS(mref) - NATIVE_CLASS_BASE;
+	native_invoke_t func = 0;
+
+	// a single table lookup instead of comparing all class ids
+	if(cls < sizeof(native_dispatch)/sizeof(native_invoke_t))
+		func = NATIVE_DISPATCH_GET(cls);
+
+	if(func)
+		func(NATIVE_ID2METHOD(mref));
+	else
 		error(ERROR_NATIVE_UNKNOWN_CLASS);
 }
 
@@ -33,6 +33,8 @@
 #include "vm.h"
 #include "native.h"
 #include "native_stm32.h"
+#include "latency.h"
+#include "thread.h"
 #include "stack.h"
 #include "uart.h"
 #include "eeprom.h"
@@ -42,6 +44,9 @@
 /* Private variables ---------------------------------------------------------*/
 
 volatile static nvm_int_t ticks;
+#if defined(NVM_USE_LATENCY) || defined(NVM_USE_THREADS)
+volatile static u32_t clock_ticks;   // like ticks, but never reset
+#endif
 
 /* Virtual address defined by the user: 0xFFFF value is prohibited */
 uint16_t VirtAddVarTab[NumbOfVar] = {0x5555, 0x6666, 0x7777};
@@ -58,12 +63,46 @@ void TIM1_IRQHandler(void)
 	{
 		/* Update system's ticks */
 		ticks++;
+#if defined(NVM_USE_LATENCY) || defined(NVM_USE_THREADS)
+		clock_ticks++;
+#endif
 
 		/* Clear UIF flag */
 		TIM_ClearITPendingBit(TIM1, TIM_IT_Update);
 	}
 }
 
+#ifdef NVM_USE_LATENCY
+/* Time in microseconds for the latency histograms, TIM1 counts
+   at 1 MHz and wraps every ARR+1 counts. A wrap whose interrupt
+   is still pending isn't counted in clock_ticks yet */
+u32_t latency_clock(void)
+{
+	u32_t c, period = TIM1->ARR + 1;
+	u16_t cnt, pending;
+
+	do {
+		c = clock_ticks;
+		cnt = TIM_GetCounter(TIM1);
+		pending = TIM1->SR & TIM_FLAG_Update;
+	} while(c != clock_ticks);
+
+	/* a small count belongs to the wrap that is pending */
+	if (pending && (cnt < period/2))
+		c++;
+
+	return c * period + cnt;
+}
+#endif
+
+#ifdef NVM_USE_THREADS
+/* Timer ticks for Thread.sleep() */
+u32_t thread_clock(void)
+{
+	return clock_ticks;
+}
+#endif
+
 void native_init(void)
 {
 	NVIC_InitTypeDef NVIC_InitStructure;
@@ -170,7 +209,11 @@ void native_stm32_timer_invoke(u08_t mref){
 	} else if(mref == NATIVE_METHOD_TWAIT) {
 		nvm_int_t wait = stack_pop_int();
 		ticks = 0;
-	while(ticks < wait);      // reset watchdog here if enabled
+#ifdef NVM_USE_THREADS
+		thread_sleep(wait);       // the other threads run meanwhile
+#else
+		while(ticks < wait);      // reset watchdog here if enabled
+#endif
 	} else if(mref == NATIVE_METHOD_SETPRESCALER) {
 		/*TCCR1B = */stack_pop_int();
 	} else
@@ -0,0 +1,171 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+//
+//  symbols.c
+//
+//  Loads the symbol map NanoVMTool writes next to an nvm file
+//  (Fibonacci.map for Fibonacci.nvm) so the unix version can print
+//  method names and source lines in profiles and error reports.
+//  Only the method and line records are used, constants and
+//  strings are there for external tools.
+//
+
+#include "types.h"
+#include "config.h"
+#include "debug.h"
+
+#ifdef NVM_USE_SYMBOLS
+
+#ifndef UNIX
+#error "NVM_USE_SYMBOLS is only supported by the unix version"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm.h"
+#include "symbols.h"
+
+typedef struct {
+  u16_t mref;
+  char *name;
+} symbols_method_t;
+
+typedef struct {
+  u16_t mref;
+  u16_t pc;
+  u16_t line;
+} symbols_line_t;
+
+bool_t symbols_enabled = FALSE;
+
+#ifndef NVM_USE_CONTEXT
+u16_t symbols_mref = 0xffff;
+u16_t symbols_pc;
+#endif
+
+static symbols_method_t *symbols_methods;
+static u16_t symbols_method_count;
+static symbols_line_t *symbols_lines;
+static u16_t symbols_line_count;
+
+// load the map belonging to nvmfile if there is one, the method
+// numbers in it are relative to base (the library is numbered
+// behind the application)
+void symbols_load(char *nvmfile, u16_t base) {
+  char line[256], name[256], *p;
+  unsigned int a, b, c, d;
+  FILE *in;
+
+  strncpy(name, nvmfile, sizeof(name)-5);
+  name[sizeof(name)-5] = 0;
+  if((p = strrchr(name, '.')) && !strcmp(p, ".nvm"))
+    *p = 0;
+  strcat(name, ".map");
+
+  if(!(in = fopen(name, "r")))
+    return;
+
+  while(fgets(line, sizeof(line), in)) {
+    line[strcspn(line, "\r\n")] = 0;
+
+    if(sscanf(line, "method %u %u %u %255s", &a, &b, &c, name) == 4) {
+      symbols_methods = realloc(symbols_methods,
+	       (symbols_method_count+1) * sizeof(symbols_method_t));
+      symbols_methods[symbols_method_count].mref = base + a;
+      symbols_methods[symbols_method_count].name = strdup(name);
+      symbols_method_count++;
+    } else if(sscanf(line, "line %u %u %u", &a, &b, &d) == 3) {
+      symbols_lines = realloc(symbols_lines,
+	       (symbols_line_count+1) * sizeof(symbols_line_t));
+      symbols_lines[symbols_line_count].mref = base + a;
+      symbols_lines[symbols_line_count].pc = b;
+      symbols_lines[symbols_line_count].line = d;
+      symbols_line_count++;
+    }
+  }
+
+  fclose(in);
+  symbols_enabled = TRUE;
+}
+
+char *symbols_method(u16_t mref) {
+  u16_t i;
+
+  for(i=0;i<symbols_method_count;i++)
+    if(symbols_methods[i].mref == mref)
+      return symbols_methods[i].name;
+
+  return NULL;
+}
+
+// method by name, either Class.name or Class.name:signature,
+// 0xffff if there's none
+u16_t symbols_find(char *name) {
+  u16_t i, len = strlen(name);
+
+  for(i=0;i<symbols_method_count;i++) {
+    char *m = symbols_methods[i].name;
+    if(!strncmp(m, name, len) && (!m[len] || (m[len] == ':')))
+      return symbols_methods[i].mref;
+  }
+
+  return 0xffff;
+}
+
+// source line of the given bytecode offset or -1 if unknown
+s16_t symbols_line(u16_t mref, u16_t pc) {
+  s16_t line = -1;
+  u16_t i, start = 0;
+
+  // the entry with the highest start pc not behind pc
+  for(i=0;i<symbols_line_count;i++) {
+    symbols_line_t *l = &symbols_lines[i];
+    if((l->mref == mref) && (l->pc <= pc) && ((line < 0) || (l->pc >= start))) {
+      start = l->pc;
+      line = l->line;
+    }
+  }
+
+  return line;
+}
+
+// print the location of the current instruction
+void symbols_where(void) {
+  char *name;
+  s16_t line;
+
+  if(SYMBOLS_MREF == 0xffff)
+    return;
+
+  name = symbols_method(SYMBOLS_MREF);
+  line = symbols_line(SYMBOLS_MREF, SYMBOLS_PC);
+
+  printf("  at ");
+  if(name) printf("%s", name);
+  else     printf("method %u", SYMBOLS_MREF);
+  printf(" pc %u", SYMBOLS_PC);
+  if(line >= 0)
+    printf(" (line %d)", line);
+  printf("\n");
+}
+
+#endif // NVM_USE_SYMBOLS
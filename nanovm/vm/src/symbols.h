@@ -0,0 +1,61 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+//
+//  symbols.h
+//
+
+#ifndef SYMBOLS_H
+#define SYMBOLS_H
+
+#include "types.h"
+#include "config.h"
+
+#ifdef NVM_USE_SYMBOLS
+
+// set once a map is loaded or the sampler runs, vm_run only keeps
+// track of the position (and pays for it) then
+extern bool_t symbols_enabled;
+
+// method being executed and its bytecode offset, kept up to date by
+// vm_run to be able to tell where an error happened. Every vm context
+// has its own, the users include vm.h for it
+#ifdef NVM_USE_CONTEXT
+#define SYMBOLS_MREF  (nvm_context->symbols_mref)
+#define SYMBOLS_PC    (nvm_context->symbols_pc)
+#else
+extern u16_t symbols_mref;
+extern u16_t symbols_pc;
+#define SYMBOLS_MREF  symbols_mref
+#define SYMBOLS_PC    symbols_pc
+#endif
+
+void  symbols_load(char *nvmfile, u16_t base);
+char  *symbols_method(u16_t mref);
+u16_t symbols_find(char *name);
+s16_t symbols_line(u16_t mref, u16_t pc);
+void  symbols_where(void);
+
+#define SYMBOLS_AT(m, p)  do { if(symbols_enabled) { \
+      SYMBOLS_MREF = (m); SYMBOLS_PC = (p); } } while(0)
+#else
+#define SYMBOLS_AT(m, p)
+#endif
+
+#endif // SYMBOLS_H
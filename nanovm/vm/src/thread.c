@@ -0,0 +1,376 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+
+//
+//  thread.c
+//
+//  Green threads (nanovm.lang.Thread). All threads run in the one
+//  interpreter loop, it switches to the next runnable thread every
+//  THREAD_BYTECODES bytecodes and whenever the running one sleeps,
+//  yields or joins. main() keeps the stack stolen from the heap,
+//  every other thread gets THREAD_STACK entries of its own where
+//  its frames are chained just like those of main(). A thread ends
+//  when its run() returns, main() returns once all have ended.
+//
+
+#include "types.h"
+#include "config.h"
+#include "debug.h"
+#include "error.h"
+
+#ifdef NVM_USE_THREADS
+
+#if !defined(UNIX) && !defined(AVR) && !defined(STM32)
+#error "NVM_USE_THREADS needs a timer, only unix, avr and stm32 have one"
+#endif
+
+#ifdef UNIX
+#include <time.h>
+#endif
+
+#include "vm.h"
+#include "heap.h"
+#include "stack.h"
+#include "nvmfile.h"
+#include "native.h"
+#include "thread.h"
+
+#define NATIVE_METHOD_init         0
+#define NATIVE_METHOD_init_target  1
+#define NATIVE_METHOD_start        2
+#define NATIVE_METHOD_sleep        3
+#define NATIVE_METHOD_yield        4
+#define NATIVE_METHOD_join         5
+#define NATIVE_METHOD_isAlive      6
+
+// the field of a plain Thread object holding its Runnable
+#define THREAD_TARGET  VM_CLASS_CONST_ALLOC
+
+#ifdef NVM_USE_CONTEXT
+#define thread_table (nvm_context->thread_table)
+#else
+thread_table_t thread_table;
+#endif
+
+#ifdef UNIX
+u32_t thread_clock(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+#endif
+
+// only main() is there
+void thread_init(void) {
+  u08_t i;
+
+  for(i=0;i<THREAD_MAX;i++)
+    thread_table.thread[i].state = THREAD_FREE;
+
+  thread_table.thread[0].state = THREAD_RUNNABLE;
+  thread_table.thread[0].object = 0;
+  thread_table.current = 0;
+  thread_table.count = 1;
+  thread_table.left = 0;
+}
+
+// the next thread to run, round robin behind the running one. If
+// all sleep the vm waits for the first one to wake up
+static u08_t thread_next(void) {
+  u08_t i, n;
+  s32_t wait;
+
+  for(;;) {
+    u32_t now = thread_clock();
+    bool_t sleeping = FALSE;
+
+    wait = 0;
+    for(i=1;i<=THREAD_MAX;i++) {
+      thread_t *t;
+
+      n = (thread_table.current + i) % THREAD_MAX;
+      t = &thread_table.thread[n];
+
+      if(t->state == THREAD_SLEEPING) {
+	if((s32_t)(t->wakeup - now) <= 0)
+	  t->state = THREAD_RUNNABLE;
+	else if(!sleeping || ((s32_t)(t->wakeup - now) < wait)) {
+	  wait = t->wakeup - now;
+	  sleeping = TRUE;
+	}
+      }
+
+      // main() has returned and the others have ended meanwhile
+      if((t->state == THREAD_JOINING) && (t->join == THREAD_ALL) &&
+	 (thread_table.count == 1))
+	t->state = THREAD_RUNNABLE;
+
+      if(t->state == THREAD_RUNNABLE)
+	return n;
+    }
+
+    // no thread left that could ever run again
+    if(!sleeping)
+      error(ERROR_VM_STACK_CORRUPTED);
+
+#ifdef UNIX
+    {
+      struct timespec ts = { wait / 1000, (wait % 1000) * 1000000L };
+      nanosleep(&ts, NULL);
+    }
+#endif
+  }
+}
+
+// let the others run for time thread_clock() units, the switch
+// happens before the next bytecode
+void thread_sleep(nvm_int_t time) {
+  if(time > 0) {
+    thread_table.thread[thread_table.current].state = THREAD_SLEEPING;
+    thread_table.thread[thread_table.current].wakeup = thread_clock() + time;
+  }
+  thread_table.left = 1;
+}
+
+// save the running thread and continue with the next one, mref
+// and pc (relative to the method header) are those of the next
+// bytecode
+void thread_switch(u16_t *mref, u16_t *pc) {
+  thread_t *t = &thread_table.thread[thread_table.current];
+
+  t->mref = *mref;
+  t->pc = *pc;
+  t->sp = stack_get_sp();
+  t->stackbase = stack_get_base();
+  t->frame = VM_LOCALS;
+
+  thread_table.current = thread_next();
+  DEBUGF("thread switch to %d\n", thread_table.current);
+
+  t = &thread_table.thread[thread_table.current];
+  stack_switch(t->sp, t->stackbase);
+  VM_LOCALS = t->frame;
+  *mref = t->mref;
+  *pc = t->pc;
+
+  // main() alone isn't interrupted anymore
+  thread_table.left = (thread_table.count > 1)?THREAD_BYTECODES:0;
+}
+
+// the outermost method of the running thread returns. FALSE if
+// that ends the vm run, i.e. main() has no other threads to wait
+// for, otherwise the next thread is scheduled
+bool_t thread_return(void) {
+  thread_t *t = &thread_table.thread[thread_table.current];
+  u08_t i;
+
+  if(!thread_table.current) {
+    if(thread_table.count == 1)
+      return FALSE;
+
+    // the return is executed again once the others have ended
+    t->state = THREAD_JOINING;
+    t->join = THREAD_ALL;
+  } else {
+    t->state = THREAD_FREE;
+    thread_table.count--;
+
+    for(i=0;i<THREAD_MAX;i++)
+      if((thread_table.thread[i].state == THREAD_JOINING) &&
+	 (thread_table.thread[i].join == thread_table.current))
+	thread_table.thread[i].state = THREAD_RUNNABLE;
+  }
+
+  thread_table.left = 1;
+  return TRUE;
+}
+
+// main() runs on the stack stolen from the heap, the other threads
+// only check that the frame fits into their own
+void thread_steal(u16_t bytes) {
+  if(!thread_table.current)
+    heap_steal(bytes);
+  else if((stack_get_sp() - thread_table.stack[thread_table.current-1]) +
+	  bytes/sizeof(nvm_stack_t) >= THREAD_STACK)
+    error(ERROR_HEAP_OUT_OF_STACK_MEMORY);
+}
+
+void thread_unsteal(u16_t bytes) {
+  if(!thread_table.current)
+    heap_unsteal(bytes);
+}
+
+// top of the stack of main(), also while another thread runs
+nvm_stack_t *thread_main_sp(void) {
+  return thread_table.current?thread_table.thread[0].sp:stack_get_sp();
+}
+
+// search the stacks of the threads other than main() and their
+// Thread objects
+bool_t thread_heap_id_in_use(nvm_ref_t ref) {
+  u08_t i;
+
+  for(i=1;i<THREAD_MAX;i++) {
+    thread_t *t = &thread_table.thread[i];
+    nvm_stack_t *p, *top;
+
+    if(t->state == THREAD_FREE)
+      continue;
+
+    if(t->object == ref)
+      return TRUE;
+
+    top = (i == thread_table.current)?stack_get_sp():t->sp;
+    for(p=thread_table.stack[i-1];p<=top;p++)
+      if(*p == ref)
+	return TRUE;
+  }
+
+  return FALSE;
+}
+
+// new Thread(): the class reference like a local object and the
+// Runnable to run, which the gc has to find
+void thread_new(u16_t mref) {
+  heap_id_t h = heap_alloc(TRUE, sizeof(nvm_word_t) * (VM_CLASS_CONST_ALLOC+1));
+
+  ((nvm_ref_t*)heap_get_addr(h))[0] = mref;
+  ((nvm_word_t*)heap_get_addr(h))[THREAD_TARGET] = 0;
+
+  stack_push(NVM_TYPE_HEAP | h);
+}
+
+static nvm_word_t *thread_object(nvm_ref_t ref) {
+  if((ref & NVM_TYPE_MASK) != NVM_TYPE_HEAP)
+    error(ERROR_VM_ILLEGAL_REFERENCE);
+
+  return heap_get_addr(ref & ~NVM_TYPE_MASK);
+}
+
+// the thread started with this object, 0 if it's not running
+static u08_t thread_find(nvm_ref_t ref) {
+  u08_t i;
+
+  for(i=1;i<THREAD_MAX;i++)
+    if((thread_table.thread[i].state != THREAD_FREE) &&
+       (thread_table.thread[i].object == ref))
+      return i;
+
+  return 0;
+}
+
+static void thread_start(nvm_ref_t ref) {
+  nvm_method_hdr_t mhdr, *mhdr_ptr;
+  nvm_ref_t run = ref;
+  thread_t *t;
+  u16_t mref;
+  u08_t class, i;
+
+  if(thread_find(ref))
+    error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+
+  // a plain Thread runs its Runnable, a subclass its own run()
+  class = NATIVE_ID2CLASS(((nvm_ref_t*)thread_object(ref))[0]);
+  if(class == NATIVE_CLASS_THREAD) {
+    run = thread_object(ref)[THREAD_TARGET];
+    if(!run)
+      return;
+    class = NATIVE_ID2CLASS(((nvm_ref_t*)thread_object(run))[0]);
+  }
+
+  if((class >= NATIVE_CLASS_BASE) ||
+     ((mref = nvmfile_get_method_by_class_and_id(class,
+					NVMFILE_METHOD_ID_RUN)) == 0xffff))
+    error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+
+  for(i=1;(i<THREAD_MAX) && (thread_table.thread[i].state != THREAD_FREE);i++);
+
+  mhdr_ptr = nvmfile_get_method_hdr(mref);
+  nvmfile_read(&mhdr, mhdr_ptr, sizeof(nvm_method_hdr_t));
+
+  if((i == THREAD_MAX) || (mhdr.max_locals + mhdr.max_stack > THREAD_STACK))
+    error(ERROR_HEAP_OUT_OF_STACK_MEMORY);
+
+  DEBUGF("thread %d runs method %d\n", i, mref);
+
+  // run() gets the object as its only argument and starts with
+  // an empty stack behind its locals
+  t = &thread_table.thread[i];
+  t->frame = thread_table.stack[i-1];
+  t->frame[0] = run;
+  t->sp = t->frame + mhdr.max_locals - 1;
+  t->stackbase = t->sp;
+  t->mref = mref;
+  t->pc = mhdr.code_index;
+  t->object = ref;
+  t->state = THREAD_RUNNABLE;
+  thread_table.count++;
+
+  if(!thread_table.left)
+    thread_table.left = THREAD_BYTECODES;
+}
+
+static void thread_join(nvm_ref_t ref) {
+  u08_t i = thread_find(ref), j, n;
+
+  if(!i)
+    return;
+
+  // a thread joining itself or one (indirectly) joining it would
+  // wait forever
+  for(j=i,n=0;n<THREAD_MAX;n++) {
+    if(j == thread_table.current)
+      error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+    if((thread_table.thread[j].state != THREAD_JOINING) ||
+       (thread_table.thread[j].join == THREAD_ALL))
+      break;
+    j = thread_table.thread[j].join;
+  }
+
+  thread_table.thread[thread_table.current].state = THREAD_JOINING;
+  thread_table.thread[thread_table.current].join = i;
+  thread_table.left = 1;
+}
+
+// nanovm.lang.Thread
+void native_thread_invoke(u08_t mref) {
+  if(mref == NATIVE_METHOD_init) {
+    stack_pop();
+  } else if(mref == NATIVE_METHOD_init_target) {
+    nvm_ref_t target = stack_pop();
+    nvm_word_t *obj = thread_object(stack_pop());
+    // a subclass has no room for it and runs its own run()
+    if(NATIVE_ID2CLASS(((nvm_ref_t*)obj)[0]) == NATIVE_CLASS_THREAD)
+      obj[THREAD_TARGET] = target;
+  } else if(mref == NATIVE_METHOD_start) {
+    thread_start(stack_pop());
+  } else if(mref == NATIVE_METHOD_sleep) {
+    thread_sleep(stack_pop_int());
+  } else if(mref == NATIVE_METHOD_yield) {
+    thread_table.left = 1;
+  } else if(mref == NATIVE_METHOD_join) {
+    thread_join(stack_pop());
+  } else if(mref == NATIVE_METHOD_isAlive) {
+    stack_push(thread_find(stack_pop())?1:0);
+  } else
+    error(ERROR_NATIVE_UNKNOWN_METHOD);
+}
+
+#endif // NVM_USE_THREADS
@@ -0,0 +1,98 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+
+//
+//  thread.h
+//
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include "types.h"
+#include "config.h"
+#include "nvmtypes.h"
+
+#ifdef NVM_USE_THREADS
+
+#ifndef THREAD_MAX
+#define THREAD_MAX        4     // threads incl. the one running main()
+#endif
+#ifndef THREAD_STACK
+#define THREAD_STACK      64    // stack entries of each of the others
+#endif
+#ifndef THREAD_BYTECODES
+#define THREAD_BYTECODES  200   // bytecodes before the next thread's turn
+#endif
+
+#define THREAD_FREE       0
+#define THREAD_RUNNABLE   1
+#define THREAD_SLEEPING   2
+#define THREAD_JOINING    3
+
+#define THREAD_ALL        0xff  // joined by main() once it returns
+
+typedef struct {
+  u08_t state;
+  u08_t join;                 // thread waited for while joining
+  u16_t mref;                 // method and offset of the next
+  u16_t pc;                   // bytecode while not running
+  nvm_stack_t *sp;
+  nvm_stack_t *stackbase;
+  nvm_stack_t *frame;         // locals of its current method
+  u32_t wakeup;               // thread_clock() to wake up at
+  nvm_ref_t object;           // the Thread object, 0 for main()
+} thread_t;
+
+typedef struct {
+  thread_t thread[THREAD_MAX];
+  u08_t current;
+  u08_t count;                // threads not free
+  u16_t left;                 // bytecodes until the next switch, 0: never
+  nvm_stack_t stack[THREAD_MAX-1][THREAD_STACK];
+} thread_table_t;
+
+#ifdef NVM_USE_CONTEXT
+#define THREAD_TABLE (nvm_context->thread_table)
+#else
+extern thread_table_t thread_table;
+#define THREAD_TABLE thread_table
+#endif
+
+// platform timer: milliseconds on unix, timer 1 ticks on the avr
+// and the stm32
+u32_t thread_clock(void);
+
+void thread_init(void);
+void thread_switch(u16_t *mref, u16_t *pc);
+void thread_sleep(nvm_int_t time);
+bool_t thread_return(void);
+void thread_steal(u16_t bytes);
+void thread_unsteal(u16_t bytes);
+nvm_stack_t *thread_main_sp(void);
+bool_t thread_heap_id_in_use(nvm_ref_t ref);
+void thread_new(u16_t mref);
+void native_thread_invoke(u08_t mref);
+
+// a compare per bytecode as long as main() runs alone
+#define THREAD_TICK()  (THREAD_TABLE.left && !--THREAD_TABLE.left)
+
+#endif // NVM_USE_THREADS
+
+#endif // THREAD_H
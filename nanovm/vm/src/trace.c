@@ -0,0 +1,111 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+//
+//  trace.c
+//
+//  Records the last TRACE_SIZE executed instructions in a ring
+//  buffer. The unix version writes it to a file at exit (also after
+//  a vm error), "NanoVMTool -t file [map]" decodes it. The file
+//  starts with the magic "NVMT", the record size and the number of
+//  instructions recorded in total, followed by the records, oldest
+//  first.
+//
+
+#include "types.h"
+#include "config.h"
+#include "debug.h"
+
+#ifdef NVM_USE_TRACE
+
+#ifdef UNIX
+#include <stdio.h>
+#include <stdlib.h>
+#endif
+
+#include "stack.h"
+#include "trace.h"
+
+#if TRACE_SIZE & (TRACE_SIZE-1)
+#error "TRACE_SIZE must be a power of two"
+#endif
+
+bool_t trace_enabled = FALSE;
+
+static trace_t trace_buf[TRACE_SIZE];
+static u32_t trace_count;
+
+void trace_instr(u16_t mref, u16_t pc, u08_t instr) {
+  trace_t *t = &trace_buf[trace_count++ & (TRACE_SIZE-1)];
+
+  t->mref = mref;
+  t->pc = pc;
+  t->instr = instr;
+  t->depth = stack_get_depth();
+}
+
+#ifdef UNIX
+static char *trace_file;
+
+void trace_enable(char *filename) {
+  trace_file = filename;
+  trace_enabled = TRUE;
+  atexit(trace_dump);
+}
+
+static void trace_write16(FILE *out, u16_t val) {
+  fputc(val & 0xff, out);
+  fputc(val >> 8, out);
+}
+
+void trace_dump(void) {
+  u32_t i, start = 0;
+  FILE *out;
+
+  if(!trace_enabled)
+    return;
+  trace_enabled = FALSE;
+
+  if(!(out = fopen(trace_file, "wb"))) {
+    perror(trace_file);
+    return;
+  }
+
+  fwrite("NVMT", 1, 4, out);
+  fputc(sizeof(trace_t), out);
+  trace_write16(out, trace_count & 0xffff);
+  trace_write16(out, trace_count >> 16);
+
+  if(trace_count > TRACE_SIZE)
+    start = trace_count - TRACE_SIZE;
+
+  // written field by field to be independent of the host byte order
+  for(i=start;i<trace_count;i++) {
+    trace_t *t = &trace_buf[i & (TRACE_SIZE-1)];
+    trace_write16(out, t->mref);
+    trace_write16(out, t->pc);
+    fputc(t->instr, out);
+    fputc(t->depth, out);
+  }
+
+  fclose(out);
+}
+#endif // UNIX
+
+#endif // NVM_USE_TRACE
@@ -0,0 +1,59 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+//
+//  trace.h
+//
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "types.h"
+#include "config.h"
+
+#ifdef NVM_USE_TRACE
+
+// number of instructions kept in the ring buffer, power of two
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 4096
+#endif
+
+// one executed instruction, 6 bytes little endian in the trace file
+typedef struct {
+  u16_t mref;
+  u16_t pc;       // bytecode offset within the method
+  u08_t instr;
+  u08_t depth;    // stack depth before the instruction
+} __attribute__((packed)) trace_t;
+
+extern bool_t trace_enabled;
+
+void trace_instr(u16_t mref, u16_t pc, u08_t instr);
+#ifdef UNIX
+void trace_enable(char *filename);
+void trace_dump(void);
+#endif
+
+// the check is inlined, a disabled trace costs one compare
+#define TRACE_INSTR(m, p, i)  do { if(trace_enabled) trace_instr(m, p, i); } while(0)
+#else
+#define TRACE_INSTR(m, p, i)
+#endif
+
+#endif // TRACE_H
@@ -35,6 +35,7 @@ extern "C" {
 
 typedef uint32_t  u32_t;
 typedef int32_t   s32_t;
+typedef int64_t   s64_t;
 typedef uint16_t  u16_t;
 typedef int16_t   s16_t;
 typedef uint8_t   u08_t;
@@ -27,6 +27,7 @@
 
 #include "uart.h"
 #include "delay.h"
+#include "vm.h"
 
 // unix uart emulation
 #ifdef UNIX
@@ -35,13 +36,49 @@
 #include <signal.h>
 #include <termios.h>
 #include <stdio.h>
-#include <sys/select.h>
+#include <unistd.h>
+#include <poll.h>
+#ifdef UART_FLUSH_MS
+#include <sys/time.h>
+#endif
+
+// output is collected in the libc buffer and only written on newline,
+// before waiting for input and on exit
+#ifndef UART_OUTPUT_BUFFER
+#define UART_OUTPUT_BUFFER 4096
+#endif
 
 struct termios old_t;
 
 FILE *in = NULL, *out = NULL;
+static char uart_out_buf[UART_OUTPUT_BUFFER];
+
+// input is read ahead into a ring buffer whenever the fd is readable
+#ifndef UART_INPUT_BUFFER_BITS
+#define UART_INPUT_BUFFER_BITS 8
+#endif
+#define UART_INPUT_BUFFER_SIZE  (1<<(UART_INPUT_BUFFER_BITS))
+#define UART_INPUT_BUFFER_MASK  ((UART_INPUT_BUFFER_SIZE)-1)
+
+static u08_t uart_in_buf[UART_INPUT_BUFFER_SIZE];
+static u16_t uart_in_rd = 0, uart_in_wr = 0;
+static bool_t uart_in_eof = FALSE;
+
+#ifdef UART_FLUSH_MS
+// time of the oldest unflushed byte
+static struct timeval uart_pending = { 0, 0 };
+#endif
+
+void uart_flush(void) {
+  fflush(out);
+#ifdef UART_FLUSH_MS
+  uart_pending.tv_sec = 0;
+#endif
+}
 
 void uart_bye(void) {
+  uart_flush();
+
 #ifdef UART_PORT
   fclose(in);  // out is identical
 #else
@@ -82,34 +119,136 @@ void uart_init(void) {
   new_t.c_lflag &= ~(ECHO|ICANON);
 
   tcsetattr( 0, TCSANOW, &new_t);
-
-  // libc buffers off
-  setbuf(stdin, NULL);
 #endif
 
+  setvbuf(out, uart_out_buf, _IOFBF, sizeof(uart_out_buf));
+
   atexit(uart_bye);
   signal(SIGINT, uart_sigproc);
 }
 
+// flush after a newline or, with UART_FLUSH_MS, after the
+// oldest unflushed output is too old
+static void uart_written(bool_t newline) {
+  if(newline) {
+    uart_flush();
+    return;
+  }
+
+#ifdef UART_FLUSH_MS
+  struct timeval now;
+  gettimeofday(&now, NULL);
+
+  if(!uart_pending.tv_sec)
+    uart_pending = now;
+  else if((now.tv_sec - uart_pending.tv_sec) * 1000 +
+	  (now.tv_usec - uart_pending.tv_usec) / 1000 >= UART_FLUSH_MS)
+    uart_flush();
+#endif
+}
+
 void uart_write_byte(u08_t byte) {
+#ifdef NVM_USE_CONTEXT
+  if(nvm_context->host_output) {
+    nvm_context->host_output(&byte, 1);
+    return;
+  }
+#endif
+
   fputc(byte, out);
-  fflush(out);
+  uart_written(byte == '\n');
+}
+
+void uart_write_block(const u08_t *data, u16_t len) {
+#ifdef NVM_USE_CONTEXT
+  if(nvm_context->host_output) {
+    nvm_context->host_output(data, len);
+    return;
+  }
+#endif
+
+  fwrite(data, 1, len, out);
+  uart_written(memchr(data, '\n', len) != NULL);
+}
+
+// wait up to timeout ms (-1 = forever) for the fd to become readable
+// and read as much as fits into the ring buffer
+static void uart_fill(int timeout) {
+  struct pollfd pfd = { 0, POLLIN, 0 };
+  u16_t used = uart_in_wr - uart_in_rd;
+  ssize_t len;
+
+  // without uart_init() (vm embedded in a program) there's no input
+  if(!in)
+    uart_in_eof = TRUE;
+
+  if((used == UART_INPUT_BUFFER_SIZE) || uart_in_eof)
+    return;
+
+  pfd.fd = fileno(in);
+
+  // the other side may wait for our output before sending
+  uart_flush();
+
+  if(poll(&pfd, 1, timeout) != 1)
+    return;
+
+  // read up to the end of the buffer, the rest follows next time
+  len = UART_INPUT_BUFFER_SIZE - (uart_in_wr & UART_INPUT_BUFFER_MASK);
+  if(len > UART_INPUT_BUFFER_SIZE - used)
+    len = UART_INPUT_BUFFER_SIZE - used;
+
+  len = read(pfd.fd, uart_in_buf + (uart_in_wr & UART_INPUT_BUFFER_MASK), len);
+  if(len > 0)
+    uart_in_wr += len;
+  else
+    uart_in_eof = TRUE;
+}
+
+static u08_t uart_buffered(void) {
+  u16_t used = uart_in_wr - uart_in_rd;
+
+  // behave like a stream that is always readable at end of file
+  if(!used && uart_in_eof)
+    return 1;
+
+  return (used > 255)?255:used;
 }
 
 u08_t uart_read_byte(void) {
-  return fgetc(in);
+  if(uart_in_rd == uart_in_wr)
+    uart_fill(-1);
+
+  // end of file reads as 0xff
+  if(uart_in_rd == uart_in_wr)
+    return 0xff;
+
+  return uart_in_buf[uart_in_rd++ & UART_INPUT_BUFFER_MASK];
+}
+
+void uart_unread_byte(u08_t byte) {
+  if((u16_t)(uart_in_wr - uart_in_rd) < UART_INPUT_BUFFER_SIZE)
+    uart_in_buf[--uart_in_rd & UART_INPUT_BUFFER_MASK] = byte;
 }
 
-// unix can't tell us how many bytes in the input buffer are,
-// so just return one as long as there's data
+bool_t uart_eof(void) {
+  return (uart_in_rd == uart_in_wr) && uart_in_eof;
+}
+
+// number of bytes that can be read without blocking
 u08_t uart_available(void) {
-  fd_set fds;
-  struct timeval tv = { 0, 100 };
+  if(uart_in_rd == uart_in_wr)
+    uart_fill(0);
+
+  return uart_buffered();
+}
 
-  FD_ZERO(&fds);
-  FD_SET(fileno(in), &fds);
+// wait up to ms milliseconds for input
+u08_t uart_wait(u16_t ms) {
+  if(uart_in_rd == uart_in_wr)
+    uart_fill(ms);
 
-  return (select(FD_SETSIZE, &fds, NULL, NULL, &tv) == 1)?1:0;
+  return uart_buffered();
 }
 
 #endif  // UNIX
@@ -223,6 +362,15 @@ u08_t uart_read_byte(void) {
   return ret;
 }
 
+void uart_unread_byte(u08_t byte) {
+  // a full buffer drops it like the receiver does
+  if(uart_available() == UART_BUFFER_MASK)
+    return;
+
+  uart_rd = ((uart_rd-1) & UART_BUFFER_MASK);
+  uart_buf[uart_rd] = byte;
+}
+
 #endif // AVR
 
 #ifdef STM32
@@ -421,6 +569,20 @@ void uart_write_byte (u08_t c) {
 	return (p->buf [(p->out++) & (RBUF_SIZE - 1)]);
 }
 
+/*------------------------------------------------------------------------------
+  uart_unread_byte
+  put a character back in front of the rx buffer
+ *------------------------------------------------------------------------------*/
+void uart_unread_byte (u08_t c) {
+	struct buf_st *p = &rbuf;
+
+	// If the buffer is full, drop it like the receive interrupt does
+	if ((u08_t)(p->in - p->out) == RBUF_SIZE - 1)
+		return;
+
+	p->buf [(--p->out) & (RBUF_SIZE - 1)] = c;
+}
+
 /*------------------------------------------------------------------------------
   uart_available
   count bytes in rx buffer
@@ -468,3 +630,17 @@ void uart_putc(u08_t byte) {
 	uart_write_byte(byte);
 }
 
+#ifndef UNIX
+void uart_write_block(const u08_t *data, u16_t len) {
+	while(len--)
+		uart_write_byte(*data++);
+}
+
+// wait up to ms milliseconds for input
+u08_t uart_wait(u16_t ms) {
+	while(ms-- && !uart_available())
+		delay(MILLISEC(1));
+
+	return uart_available();
+}
+#endif
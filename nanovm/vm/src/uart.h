@@ -22,8 +22,22 @@
 
 extern void uart_init(void);
 extern void uart_write_byte(u08_t byte);
+extern void uart_write_block(const u08_t *data, u16_t len);
 extern void uart_putc(u08_t byte);
 extern u08_t uart_read_byte(void);
 extern u08_t uart_available(void);
+extern u08_t uart_wait(u16_t ms);
+// give back a byte, it is the next one read
+extern void uart_unread_byte(u08_t byte);
+
+#ifdef UNIX
+// write out buffered output
+extern void uart_flush(void);
+// all input has been read and there won't be more
+extern bool_t uart_eof(void);
+#else
+#define uart_flush()
+#define uart_eof() FALSE
+#endif
 
 #endif // UART_H
@@ -0,0 +1,196 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+
+//
+//  floatcheck.c
+//
+//  Compares the float to string conversion of nvmfloat.c with the C
+//  library of the host ("make floatcheck" in vm/build/unix). Edge
+//  cases are checked with every conversion, precision and flag,
+//  random floats with a random one of them. StringBuffer.append(float)
+//  has to print the shortest digits strtof() reads back as the float.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "types.h"
+#include "config.h"
+#include "vm.h"
+#include "nvmfloat.h"
+
+#define RANDOM_FLOATS 300000
+#define SHOW_ERRORS   20
+
+static const float cases[] = {
+  0.0f, 1.0f, 0.5f, 0.125f, 0.375f, 2.5f, 8.5f, 9.5f, 99.5f, 0.95f,
+  0.05f, 0.3f, 9.81f, 3.14159f, 3.14159265f, 2.71828f, 0.1f, 1e-4f,
+  5e-5f, 1e-5f, 1e7f, 1e10f, 9.9999995f, 16777216.0f, 16777215.0f,
+  123456789.123456f, 321.123456f, 0.000456f, 0.015625f,
+  1.4e-45f, 1e-40f, 1.17549435e-38f, 1.1754942e-38f, 3.4028235e38f,
+};
+
+static const u08_t precs[] = {
+  NVMFLOAT_DEFAULT, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 12, 15, 20, 30
+};
+
+static const char convs[] = "fFeEgGaA";
+
+static unsigned long checked, failed;
+
+static void report(float val, const char *fmt,
+		   const char *libc, const char *nvm) {
+  nvm_union_t v;
+
+  if(failed++ >= SHOW_ERRORS)
+    return;
+
+  v.f[0] = val;
+  printf("%08x %-8s libc \"%s\" nanovm \"%s\"\n",
+	 (unsigned)v.i[0], fmt, libc, nvm);
+}
+
+// the formatter prints at most NVMFLOAT_DIGS digits for %f
+static int too_long(float val, char conv, u08_t prec) {
+  char buf[64];
+
+  if((conv != 'f') && (conv != 'F'))
+    return 0;
+
+  snprintf(buf, sizeof(buf), "%.0f", (double)val);
+  return strlen(buf) + ((prec == NVMFLOAT_DEFAULT)?6:prec) > NVMFLOAT_DIGS;
+}
+
+// glibc loses a digit in "%#g" when rounding carries into a new
+// exponent, e.g. "%#.2g" of 99.5 gives "1.e+02" instead of "1.0e+02"
+static int glibc_alt_g(const char *libc, char conv, u08_t prec, u08_t flags) {
+  u08_t digits = 0;
+
+  if(!(flags & NVMFLOAT_ALT) || ((conv != 'g') && (conv != 'G')))
+    return 0;
+
+  for(;*libc && (*libc != 'e') && (*libc != 'E');libc++)
+    if((*libc >= '0') && (*libc <= '9'))
+      digits++;
+
+  return digits < ((prec == NVMFLOAT_DEFAULT)?6:prec?prec:1);
+}
+
+static void check_format(float val, char conv, u08_t prec, u08_t flags) {
+  char fmt[16], libc[128], nvm[NVMFLOAT_LEN+1], *p = fmt;
+  u08_t len;
+
+  if(too_long(val, conv, prec))
+    return;
+
+  *p++ = '%';
+  if(flags & NVMFLOAT_ALT)   *p++ = '#';
+  if(flags & NVMFLOAT_PLUS)  *p++ = '+';
+  if(flags & NVMFLOAT_SPACE) *p++ = ' ';
+  if(prec != NVMFLOAT_DEFAULT)
+    p += sprintf(p, ".%u", prec);
+  *p++ = conv;
+  *p = 0;
+
+  snprintf(libc, sizeof(libc), fmt, (double)val);
+  len = nvmfloat_format(nvm, val, conv, prec, flags);
+  nvm[len] = 0;
+
+  checked++;
+  if(strcmp(libc, nvm) && !glibc_alt_g(libc, conv, prec, flags))
+    report(val, fmt, libc, nvm);
+}
+
+// StringBuffer.append(float): %g with the shortest digits reading
+// back as val, found here by trying all precisions with the libc,
+// but in fixed notation below 10^9
+static void check_shortest(float val) {
+  char libc[32], nvm[NVMFLOAT_LEN+1], *e;
+  int prec, exp;
+
+  for(prec=1;prec<9;prec++) {
+    snprintf(libc, sizeof(libc), "%.*g", prec, (double)val);
+    if(strtof(libc, NULL) == val)
+      break;
+  }
+
+  snprintf(libc, sizeof(libc), "%.*e", prec-1, (double)val);
+  exp = (e = strchr(libc, 'e'))?atoi(e+1):0;   // inf and nan have none
+  if((exp >= prec) && (exp < 9))
+    prec = exp+1;
+
+  snprintf(libc, sizeof(libc), "%.*g", prec, (double)val);
+
+  nvm[nvmfloat_format(nvm, val, 'g', nvmfloat_shortest(val), 0)] = 0;
+
+  checked++;
+  if(strcmp(libc, nvm))
+    report(val, "append", libc, nvm);
+}
+
+static void check_all(float val) {
+  u08_t i, flags;
+  const char *c;
+
+  for(c=convs;*c;c++)
+    for(i=0;i<sizeof(precs);i++)
+      for(flags=0;flags<=(NVMFLOAT_ALT|NVMFLOAT_PLUS|NVMFLOAT_SPACE);
+	  flags+=NVMFLOAT_ALT)
+	check_format(val, *c, precs[i], flags);
+
+  check_shortest(val);
+}
+
+static u32_t random32(void) {
+  static u32_t seed = 1;
+
+  seed = seed * 1103515245L + 12345;
+  return (seed >> 16) | (seed << 16);
+}
+
+int main(int argc, char **argv) {
+  nvm_union_t v;
+  u32_t r;
+  unsigned i;
+
+  for(i=0;i<sizeof(cases)/sizeof(float);i++) {
+    check_all(cases[i]);
+    check_all(-cases[i]);
+  }
+
+  v.i[0] = (nvm_int_t)0x7f800000L;  check_all(v.f[0]);   // inf
+  v.i[0] = (nvm_int_t)0xff800000L;  check_all(v.f[0]);   // -inf
+  v.i[0] = (nvm_int_t)0x7fc00000L;  check_all(v.f[0]);   // nan
+
+  // random bit patterns cover all exponents and denormals
+  for(i=0;i<RANDOM_FLOATS;i++) {
+    v.i[0] = random32();
+    if(((v.i[0]>>23) & 0xff) == 0xff)
+      continue;
+
+    r = random32();
+    check_format(v.f[0], convs[r % (sizeof(convs)-1)],
+		 precs[(r >> 8) % sizeof(precs)], (r >> 16) & 0x0e);
+    check_shortest(v.f[0]);
+  }
+
+  printf("%lu of %lu conversions differ from the libc\n", failed, checked);
+  return failed?1:0;
+}
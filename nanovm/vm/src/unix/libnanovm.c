@@ -0,0 +1,381 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+
+//
+//  libnanovm.c
+//
+//  The vm as a library (libnanovm.a), see libnanovm.h. Every
+//  nanovm_t owns a vm context. The vm is entered with the context
+//  selected and error() set up to return to the caller.
+//
+
+#include "types.h"
+#include "config.h"
+#include "debug.h"
+#include "error.h"
+
+#ifdef NVM_USE_CONTEXT
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include <time.h>
+
+#include "vm.h"
+#include "nvmfile.h"
+#include "stack.h"
+#include "native.h"
+#include "libnanovm.h"
+
+#if (NANOVM_HOST_CLASS != NATIVE_CLASS_HOST) || \
+    (NANOVM_HOST_CLASSES != NATIVE_HOST_CLASSES)
+#error "libnanovm.h doesn't match native.h"
+#endif
+
+extern char *error_msg[];
+
+struct nanovm {
+  nvm_context_t *ctx;
+  bool_t loaded;
+  const char *message;
+
+  nanovm_output_t output;
+  void *output_user;
+
+  nanovm_native_t native[NATIVE_HOST_CLASSES];
+  void *native_user[NATIVE_HOST_CLASSES];
+
+#ifdef NVM_USE_SLICE
+  nvm_stack_t args[256];   // of the method run in slices
+#endif
+};
+
+static void nanovm_stdout(void *user, const char *data, unsigned int len) {
+  fwrite(data, 1, len, stdout);
+}
+
+static void nanovm_host_output(const u08_t *data, u16_t len) {
+  nanovm_t *vm = nvm_context->host;
+  vm->output(vm->output_user, (const char*)data, len);
+}
+
+static void nanovm_host_native(u16_t mref) {
+  nanovm_t *vm = nvm_context->host;
+  u08_t cls = NATIVE_ID2CLASS(mref) - NATIVE_CLASS_HOST;
+
+  if((NATIVE_ID2CLASS(mref) < NATIVE_CLASS_HOST) ||
+     (cls >= NATIVE_HOST_CLASSES) || !vm->native[cls])
+    error(ERROR_NATIVE_UNKNOWN_CLASS);
+
+  vm->native[cls](vm, vm->native_user[cls], NATIVE_ID2METHOD(mref));
+}
+
+nanovm_t *nanovm_new(void) {
+  nanovm_t *vm = calloc(1, sizeof(nanovm_t));
+
+  if(!vm)
+    return NULL;
+
+  if(!(vm->ctx = vm_context_new())) {
+    free(vm);
+    return NULL;
+  }
+
+  vm->ctx->host = vm;
+  vm->ctx->host_native = nanovm_host_native;
+  vm->ctx->host_output = nanovm_host_output;
+  vm->output = nanovm_stdout;
+  vm->message = "no error";
+
+  return vm;
+}
+
+void nanovm_free(nanovm_t *vm) {
+  vm_context_free(vm->ctx);
+  free(vm);
+}
+
+// run fn within the vm, an error ends it early
+static int nanovm_exec(nanovm_t *vm, void (*fn)(void *arg), void *arg) {
+  nvm_context_t *current = nvm_context;
+  jmp_buf jmp;
+  int code;
+
+  vm_context_set(vm->ctx);
+  vm->ctx->error_jmp = &jmp;
+
+  code = setjmp(jmp);
+  if(!code)
+    fn(arg);
+  else {
+    // heap and stack are in an unknown state now
+    vm->message = error_msg[code-1];
+    vm->loaded = FALSE;
+  }
+
+  vm->ctx->error_jmp = NULL;
+  vm_context_set(current);
+
+  return code?-1:0;
+}
+
+static void nanovm_init(void *arg) {
+  nvmfile_init();
+  vm_init();
+}
+
+int nanovm_load(nanovm_t *vm, const void *image, unsigned int size) {
+  nvm_context_t *current = nvm_context;
+  bool_t mapped;
+
+  vm_context_set(vm->ctx);
+  mapped = nvmfile_load_image(image, size);
+  vm_context_set(current);
+
+  vm->loaded = FALSE;
+  if(!mapped) {
+    vm->message = "unable to map the image";
+    return -1;
+  }
+
+  if(nanovm_exec(vm, nanovm_init, NULL))
+    return -1;
+
+  vm->loaded = TRUE;
+  return 0;
+}
+
+static void nanovm_main(void *arg) {
+  nvmfile_call_main();
+}
+
+int nanovm_run(nanovm_t *vm) {
+  if(!vm->loaded) {
+    vm->message = "no image loaded";
+    return -1;
+  }
+
+  return nanovm_exec(vm, nanovm_main, NULL);
+}
+
+// the number of arguments has to match the method
+static bool_t nanovm_check(nanovm_t *vm, unsigned int method,
+			   unsigned int argc) {
+  nvm_method_hdr_t mhdr;
+  nvm_context_t *current = nvm_context;
+  int params = -1;
+
+  if(!vm->loaded) {
+    vm->message = "no image loaded";
+    return FALSE;
+  }
+
+  vm_context_set(vm->ctx);
+  if(method < nvmfile_read08(&((nvm_header_t*)nvmfile_get_base())->methods)) {
+    nvmfile_read(&mhdr, nvmfile_get_method_hdr(method), sizeof(mhdr));
+    params = mhdr.args;
+  }
+  vm_context_set(current);
+
+  if((params < 0) || (argc != (unsigned int)params)) {
+    vm->message = error_msg[ERROR_NATIVE_ILLEGAL_ARGUMENT];
+    return FALSE;
+  }
+
+#ifdef NVM_USE_SLICE
+  // the stack holds the frames of the method run in slices
+  if(vm->ctx->vm_slice.state != VM_SLICE_IDLE) {
+    vm->message = "a method is running in slices";
+    return FALSE;
+  }
+#endif
+
+  return TRUE;
+}
+
+typedef struct {
+  u16_t method;
+  nvm_stack_t *args;
+  nvm_stack_t result;
+} nanovm_call_t;
+
+static void nanovm_call(void *arg) {
+  nanovm_call_t *call = arg;
+  call->result = vm_call(call->method, call->args);
+}
+
+int nanovm_invoke(nanovm_t *vm, unsigned int method,
+		  const nanovm_value_t *args, unsigned int argc,
+		  nanovm_value_t *result) {
+  nvm_stack_t stack_args[256];
+  nanovm_call_t call;
+  unsigned int i;
+
+  if(!nanovm_check(vm, method, argc))
+    return -1;
+
+  for(i=0;i<argc;i++)
+    stack_args[i] = args[i];
+
+  call.method = method;
+  call.args = stack_args;
+  call.result = 0;
+
+  if(nanovm_exec(vm, nanovm_call, &call))
+    return -1;
+
+  if(result)
+    *result = call.result;
+
+  return 0;
+}
+
+#ifdef NVM_USE_SLICE
+int nanovm_start(nanovm_t *vm, unsigned int method,
+		 const nanovm_value_t *args, unsigned int argc) {
+  nvm_context_t *current = nvm_context;
+  unsigned int i;
+
+  if(!nanovm_check(vm, method, argc))
+    return -1;
+
+  for(i=0;i<argc;i++)
+    vm->args[i] = args[i];
+
+  vm_context_set(vm->ctx);
+  vm_start_call(method, vm->args);
+  vm_context_set(current);
+
+  return 0;
+}
+
+static __thread struct timespec nanovm_deadline;
+
+static bool_t nanovm_expired(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec > nanovm_deadline.tv_sec) ||
+    ((now.tv_sec == nanovm_deadline.tv_sec) &&
+     (now.tv_nsec >= nanovm_deadline.tv_nsec));
+}
+
+typedef struct {
+  u32_t budget;
+  bool_t (*expired)(void);
+  bool_t running;
+} nanovm_slice_t;
+
+static void nanovm_run_slice(void *arg) {
+  nanovm_slice_t *slice = arg;
+  slice->running = vm_run_slice(slice->budget, slice->expired);
+}
+
+int nanovm_slice(nanovm_t *vm, uint32_t budget, uint32_t deadline_us,
+		 nanovm_value_t *result) {
+  nanovm_slice_t slice;
+
+  if(!vm->loaded) {
+    vm->message = "no image loaded";
+    return -1;
+  }
+
+  slice.budget = budget;
+  slice.expired = NULL;
+  slice.running = FALSE;
+
+  if(deadline_us) {
+    clock_gettime(CLOCK_MONOTONIC, &nanovm_deadline);
+    nanovm_deadline.tv_sec += deadline_us / 1000000;
+    nanovm_deadline.tv_nsec += (deadline_us % 1000000) * 1000;
+    if(nanovm_deadline.tv_nsec >= 1000000000) {
+      nanovm_deadline.tv_sec++;
+      nanovm_deadline.tv_nsec -= 1000000000;
+    }
+    slice.expired = nanovm_expired;
+  }
+
+  if(nanovm_exec(vm, nanovm_run_slice, &slice))
+    return -1;
+
+  if(slice.running)
+    return 1;
+
+  if(result)
+    *result = vm->ctx->vm_slice.result;
+
+  return 0;
+}
+#endif
+
+void nanovm_output(nanovm_t *vm, nanovm_output_t fn, void *user) {
+  vm->output = fn?fn:nanovm_stdout;
+  vm->output_user = user;
+}
+
+int nanovm_native(nanovm_t *vm, unsigned int class_id,
+		  nanovm_native_t fn, void *user) {
+  if((class_id < NATIVE_CLASS_HOST) ||
+     (class_id >= NATIVE_CLASS_HOST + NATIVE_HOST_CLASSES)) {
+    vm->message = error_msg[ERROR_NATIVE_UNKNOWN_CLASS];
+    return -1;
+  }
+
+  vm->native[class_id - NATIVE_CLASS_HOST] = fn;
+  vm->native_user[class_id - NATIVE_CLASS_HOST] = user;
+  return 0;
+}
+
+// the natives run with the context of the vm selected
+nanovm_value_t nanovm_pop(nanovm_t *vm) {
+  return stack_pop();
+}
+
+void nanovm_push(nanovm_t *vm, nanovm_value_t value) {
+  stack_push(value);
+}
+
+void nanovm_fail(nanovm_t *vm) {
+  error(ERROR_NATIVE_ILLEGAL_ARGUMENT);
+}
+
+const char *nanovm_error(nanovm_t *vm) {
+  return vm->message;
+}
+
+nanovm_value_t nanovm_int(int32_t val) {
+  return nvm_int2stack(val);
+}
+
+int32_t nanovm_to_int(nanovm_value_t val) {
+  return nvm_stack2int(val);
+}
+
+#ifdef NVM_USE_FLOAT
+nanovm_value_t nanovm_float(float val) {
+  return nvm_float2stack(val);
+}
+
+float nanovm_to_float(nanovm_value_t val) {
+  return nvm_stack2float(val);
+}
+#endif
+
+#endif // NVM_USE_CONTEXT
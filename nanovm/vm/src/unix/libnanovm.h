@@ -0,0 +1,98 @@
+//
+//  NanoVM, a tiny java VM for the Atmel AVR family
+//  Copyright (C) 2005 by Till Harbaum <Till@Harbaum.org>
+//
+//  This program is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+// 
+
+
+//
+//  libnanovm.h
+//
+//  C interface of libnanovm, the unix vm as a library for programs
+//  embedding it. Every nanovm_t is an independent vm, a thread may
+//  use any of them but only one thread at a time may use a vm.
+//
+//  Values are passed as they are kept on the vm stack, nanovm_int()
+//  and nanovm_float() convert them. Functions returning an int
+//  return 0 on success and -1 after a vm error, nanovm_error() then
+//  tells which one. A vm has to be loaded again after an error.
+//
+
+#ifndef LIBNANOVM_H
+#define LIBNANOVM_H
+
+#include <stdint.h>
+
+// native classes with ids from NANOVM_HOST_CLASS on are implemented
+// by the program, they are declared to NanoVMTool in a .native file
+#define NANOVM_HOST_CLASS    64
+#define NANOVM_HOST_CLASSES  16
+
+typedef struct nanovm nanovm_t;
+typedef uint32_t nanovm_value_t;
+
+// receives everything the vm writes to its uart
+typedef void (*nanovm_output_t)(void *user, const char *data, unsigned int len);
+
+// called for every native method of a host class, pops the
+// arguments and pushes the result (if any) with the functions below
+typedef void (*nanovm_native_t)(nanovm_t *vm, void *user, unsigned int method);
+
+nanovm_t *nanovm_new(void);
+void      nanovm_free(nanovm_t *vm);
+
+// load an nvm image, the vm keeps a copy
+int       nanovm_load(nanovm_t *vm, const void *image, unsigned int size);
+
+// run the static initializers and main()
+int       nanovm_run(nanovm_t *vm);
+
+// call a method by its index within the image (see the .map file),
+// result may be NULL
+int       nanovm_invoke(nanovm_t *vm, unsigned int method,
+			const nanovm_value_t *args, unsigned int argc,
+			nanovm_value_t *result);
+
+// start a method like nanovm_invoke(), nanovm_slice() then runs
+// it for up to budget bytecodes or (deadline_us > 0) until that
+// many microseconds have passed. It returns 1 while the method
+// hasn't returned yet and 0 (with its result) once it has
+int       nanovm_start(nanovm_t *vm, unsigned int method,
+		       const nanovm_value_t *args, unsigned int argc);
+int       nanovm_slice(nanovm_t *vm, uint32_t budget, uint32_t deadline_us,
+		       nanovm_value_t *result);
+
+// uart output goes to fn instead of stdout, NULL restores stdout
+void      nanovm_output(nanovm_t *vm, nanovm_output_t fn, void *user);
+
+// implement the native class with the given id
+int       nanovm_native(nanovm_t *vm, unsigned int class_id,
+			nanovm_native_t fn, void *user);
+
+// within a native method
+nanovm_value_t nanovm_pop(nanovm_t *vm);
+void           nanovm_push(nanovm_t *vm, nanovm_value_t value);
+void           nanovm_fail(nanovm_t *vm);  // illegal argument
+
+// message of the last error
+const char *nanovm_error(nanovm_t *vm);
+
+nanovm_value_t nanovm_int(int32_t val);
+int32_t        nanovm_to_int(nanovm_value_t val);
+nanovm_value_t nanovm_float(float val);
+float          nanovm_to_float(nanovm_value_t val);
+
+#endif // LIBNANOVM_H
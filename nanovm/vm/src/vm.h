@@ -32,9 +32,72 @@
 #define VM_CLASS_CONST_ALLOC  1
 
 void   vm_init(void);
+#ifdef NVM_USE_CONTEXT
+// run a method with its arguments, returns its result
+nvm_stack_t vm_call(u16_t mref, nvm_stack_t *args);
+#define vm_run(m)  vm_call(m, NULL)
+#else
 void   vm_run(u16_t mref);
+#endif
+
+#ifdef NVM_USE_SLICE
+// a method run in slices of a limited number of bytecodes, the
+// caller gets control back between them
+#define VM_SLICE_IDLE       0   // nothing started or it has returned
+#define VM_SLICE_STARTED    1   // not run yet
+#define VM_SLICE_SUSPENDED  2   // stopped between two bytecodes
+
+// slice length of main() in NanoVM.c
+#ifndef VM_SLICE_BYTECODES
+#define VM_SLICE_BYTECODES  1000
+#endif
+
+typedef struct {
+  u08_t  state;
+  bool_t active;              // within vm_run_slice()
+  u16_t  mref;                // method and offset of the next
+  u16_t  pc;                  // bytecode when suspended
+  u32_t  left;                // bytecodes left in this slice
+  bool_t (*expired)(void);    // polled every 64 bytecodes
+#ifdef NVM_USE_CONTEXT
+  nvm_stack_t *args;
+  nvm_stack_t result;         // once the method has returned
+#endif
+} vm_slice_t;
+
+#ifdef NVM_USE_CONTEXT
+void   vm_start_call(u16_t mref, nvm_stack_t *args);
+#define vm_start(m)  vm_start_call(m, NULL)
+#else
+void   vm_start(u16_t mref);
+#endif
+bool_t vm_run_slice(u32_t budget, bool_t (*expired)(void));
+#endif
 bool_t vm_heap_id_in_use(heap_id_t id);
 
+// locals of the running method
+#ifdef NVM_USE_CONTEXT
+#define VM_LOCALS  (nvm_context->locals)
+#else
+extern nvm_stack_t *locals;
+#define VM_LOCALS  locals
+#endif
+
+#ifdef NVM_USE_STATS
+// run time statistics, e.g. for benchmarking, the heap
+// keeps its own in heap_stats
+typedef struct {
+  u32_t instructions;   // bytecodes executed
+} nvm_stats_t;
+
+#ifdef NVM_USE_CONTEXT
+#define VM_STATS   (nvm_context->nvm_stats)
+#else
+extern nvm_stats_t nvm_stats;
+#define VM_STATS   nvm_stats
+#endif
+#endif
+
 // expand types
 void * vm_get_addr(nvm_ref_t ref);
 
@@ -44,10 +107,26 @@ nvm_int_t nvm_stack2int(nvm_stack_t val);
 #define nvm_ref2stack(x) (x)
 #define nvm_stack2ref(x) (x)
 
-#ifdef NVM_USE_FLOAT
+#ifdef NVM_USE_RAW_FLOAT
+// floats are kept as plain ieee bits, the garbage collector only
+// treats exact heap ids as references
+static inline nvm_stack_t nvm_float2stack(nvm_float_t val) {
+  nvm_union_t v;
+  v.f[0] = val;
+  return v.i[0];
+}
+
+static inline nvm_float_t nvm_stack2float(nvm_stack_t val) {
+  nvm_union_t v;
+  v.i[0] = val;
+  return v.f[0];
+}
+#elif defined(NVM_USE_FLOAT)
 nvm_stack_t nvm_float2stack(nvm_float_t val);
 nvm_float_t nvm_stack2float(nvm_stack_t val);
 #endif
 
 
+#include "context.h"
+
 #endif // VM_H